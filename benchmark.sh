@@ -0,0 +1,146 @@
+#!/bin/bash
+##### ANFANG DATEI # 'benchmark.sh' ####
+##### Benchmark-Serie ohne PBS: alle Kombinationen von Programm, Verfahren,
+##### Interlines, Stoerfunktion und Threads/Prozessen, je BENCH_WARMUP
+##### verworfene und BENCH_REPEAT gemessene Laeufe. Ergebnis pro Kombination
+##### (Median, Minimum, Maximum, Streuung, GFLOP/s, GB/s) als CSV und JSON,
+##### jeder einzelne Lauf zusaetzlich in <BENCH_OUT>-runs.csv.
+#####
+##### Einstellungen ueber Umgebungsvariablen (oder make benchmark BENCH_...=):
+#####   BENCH_PROGRAMS   seq openmp pthreads mpi            (seq openmp)
+#####   BENCH_METHODS    Verfahren, siehe partdiff help     (1 2 3)
+#####   BENCH_INTERLINES                                    (50 100)
+#####   BENCH_FUNCS      Stoerfunktionen                    (1 2)
+#####   BENCH_PROCS      Threads bzw. MPI-Prozesse          (1 2 4)
+#####   BENCH_TERM       Abbruch und Wert wie auf der Kommandozeile (2 200)
+#####   BENCH_OPTIONS    weitere Optionen, z.B. --precision=mixed
+#####   BENCH_WARMUP     Laeufe vor der Messung             (1)
+#####   BENCH_REPEAT     gemessene Laeufe                   (5)
+#####   BENCH_OUT        Praefix der Ausgabedateien         (benchmark)
+#####   BENCH_MPIRUN     Startbefehl fuer mpi (mpirun --oversubscribe, als
+#####                    root zusaetzlich --allow-run-as-root)
+#####
+##### GB/s ist das Streaming-Modell ohne Stoerfunktion-Tabelle: pro Punkt und
+##### Iteration 16 Byte (ein double lesen, einen schreiben), Rot-Schwarz und
+##### SOR 32 Byte (zwei Durchlaeufe), --precision=mixed 12 Byte (zwei float
+##### der Korrektur, einer der rechten Seite). Mehrgitter und CG: leer.
+
+DIR=$(cd "$(dirname "$0")" && pwd)
+
+PROGRAMS=${BENCH_PROGRAMS:-"seq openmp"}
+METHODS=${BENCH_METHODS:-"1 2 3"}
+INTERLINES=${BENCH_INTERLINES:-"50 100"}
+FUNCS=${BENCH_FUNCS:-"1 2"}
+PROCS=${BENCH_PROCS:-"1 2 4"}
+TERM=${BENCH_TERM:-"2 200"}
+OPTIONS=${BENCH_OPTIONS:-""}
+WARMUP=${BENCH_WARMUP:-1}
+REPEAT=${BENCH_REPEAT:-5}
+OUT=${BENCH_OUT:-benchmark}
+
+if [ -z "$BENCH_MPIRUN" ]
+then
+  BENCH_MPIRUN="mpirun --oversubscribe"
+  [ "$(id -u)" = 0 ] && BENCH_MPIRUN="$BENCH_MPIRUN --allow-run-as-root"
+fi
+
+# command line of one run: program, threads/processes, method, interlines, func
+command_line ()
+{
+  case $1 in
+    seq)      echo "$DIR/partdiff-seq 1 $3 $4 $5 $TERM $OPTIONS" ;;
+    openmp)   echo "$DIR/partdiff-openmp $2 $3 $4 $5 $TERM $OPTIONS" ;;
+    pthreads) echo "$DIR/partdiff-pthreads $2 $3 $4 $5 $TERM $OPTIONS" ;;
+    mpi)      echo "$BENCH_MPIRUN -np $2 $DIR/mpi/partdiff-par $2 $3 $4 $5 $TERM $OPTIONS" ;;
+  esac
+}
+
+# bytes per point and iteration of a method (streaming model, see above)
+bytes_per_point ()
+{
+  case $1 in
+    2) case "$OPTIONS" in *--precision=mixed*) echo 12 ;; *) echo 16 ;; esac ;;
+    1) echo 16 ;;
+    3|6) echo 32 ;;
+    *) echo "" ;;
+  esac
+}
+
+echo "program,method,interlines,func,procs,run,seconds,iterations,mflop" > "$OUT-runs.csv"
+echo "program,method,interlines,func,procs,runs,iterations,median_s,min_s,max_s,spread_pct,gflops,gbs" > "$OUT.csv"
+echo "[" > "$OUT.json"
+first=1
+
+for PROGRAM in $PROGRAMS
+do
+  # the sequential program has one thread
+  procs=$PROCS
+  [ "$PROGRAM" = seq ] && procs=1
+
+  for METHOD in $METHODS
+  do
+    for LINES in $INTERLINES
+    do
+      for FUNC in $FUNCS
+      do
+        for P in $procs
+        do
+          CMD=$(command_line $PROGRAM $P $METHOD $LINES $FUNC)
+          times=""
+          ok=1
+
+          for RUN in $(seq 1 $((WARMUP + REPEAT)))
+          do
+            out=$($CMD 2>&1)
+            seconds=$(echo "$out" | awk '/^Berechnungszeit:/ {print $2}')
+            iterations=$(echo "$out" | awk '/^Anzahl Iterationen:/ {print $3}')
+            mflop=$(echo "$out" | awk '/^Executed float ops:/ {print $4}')
+
+            if [ -z "$seconds" ]
+            then
+              echo "uebersprungen: $CMD" >&2
+              echo "$out" | tail -n 2 >&2
+              ok=0
+              break
+            fi
+
+            # warm-up runs are not measured
+            if [ $RUN -gt $WARMUP ]
+            then
+              times="$times $seconds"
+              echo "$PROGRAM,$METHOD,$LINES,$FUNC,$P,$((RUN - WARMUP)),$seconds,$iterations,$mflop" >> "$OUT-runs.csv"
+            fi
+          done
+
+          [ $ok = 1 ] || continue
+
+          # median, minimum, maximum and spread (max - min) / median
+          line=$(echo $times | tr ' ' '\n' | sort -g | awk -v p=$PROGRAM -v m=$METHOD -v l=$LINES -v f=$FUNC -v np=$P \
+                 -v it=$iterations -v mflop=$mflop -v bpp="$(bytes_per_point $METHOD)" '
+            { t[NR] = $1 }
+            END {
+              med = (NR % 2) ? t[(NR + 1) / 2] : (t[NR / 2] + t[NR / 2 + 1]) / 2
+              n = l * 8 + 8
+              gbs = (bpp == "") ? "" : sprintf("%.3f", bpp * (n - 1) * (n - 1) * it / med * 1e-9)
+              printf "%s,%s,%s,%s,%s,%d,%s,%.6f,%.6f,%.6f,%.2f,%.3f,%s\n", p, m, l, f, np, NR, it, med, t[1], t[NR],
+                     (t[NR] - t[1]) / med * 100, mflop / med * 1e-3, gbs
+            }')
+
+          echo "$line" >> "$OUT.csv"
+          echo "$line"
+
+          [ $first = 1 ] || echo "," >> "$OUT.json"
+          first=0
+          echo "$line" | awk -F, '{
+            printf "  {\"program\": \"%s\", \"method\": %s, \"interlines\": %s, \"func\": %s, \"procs\": %s, \"runs\": %s, ", $1, $2, $3, $4, $5, $6
+            printf "\"iterations\": %s, \"median_s\": %s, \"min_s\": %s, \"max_s\": %s, \"spread_pct\": %s, ", $7, $8, $9, $10, $11
+            printf "\"gflops\": %s, \"gbs\": %s}", $12, ($13 == "") ? "null" : $13 }' >> "$OUT.json"
+        done
+      done
+    done
+  done
+done
+
+echo "" >> "$OUT.json"
+echo "]" >> "$OUT.json"
+echo "Ergebnis: $OUT.csv, $OUT.json, $OUT-runs.csv"
@@ -0,0 +1,347 @@
+/****************************************************************************/
+/****************************************************************************/
+/**                                                                        **/
+/**                TU Muenchen - Institut fuer Informatik                  **/
+/**                                                                        **/
+/** Copyright: Prof. Dr. Thomas Ludwig                                     **/
+/**            Andreas C. Schmidt                                          **/
+/**                                                                        **/
+/** File:      counters.c                                                  **/
+/**                                                                        **/
+/** Purpose:   Hardware performance counters with perf_event_open: CPU     **/
+/**            time, cycles, instructions, LLC misses and retired FP       **/
+/**            instructions (Intel FP_ARITH_INST_RETIRED, AMD retired      **/
+/**            SSE/AVX FLOPs). Every thread opens its own events, so the   **/
+/**            counts are per thread (and per process in MPI). Events the  **/
+/**            system does not offer are reported as not available.        **/
+/**                                                                        **/
+/****************************************************************************/
+/****************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "counters.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+/* ************************************************************************ */
+/* fpEvents: raw configs of the FP events and the FLOPs per counted         */
+/* instruction; weight 0: group not used on this CPU                        */
+/* Intel: event 0xC7, umasks scalar (1), 128 bit double (2), 128 bit        */
+/* single and 256 bit double (4), 256 bit single and 512 bit double (8),    */
+/* 512 bit single (16). AMD (family 17h and later): event 0x03 counts       */
+/* FLOPs directly.                                                          */
+/* ************************************************************************ */
+static
+void
+fpEvents (unsigned long long* config, int* weight)
+{
+	static const unsigned long long intel[COUNTER_FP_GROUPS] = { 0x03c7, 0x04c7, 0x18c7, 0x60c7, 0x80c7 };
+	static const int intel_weight[COUNTER_FP_GROUPS] = { 1, 2, 4, 8, 16 };
+	int g;
+
+	for (g = 0; g < COUNTER_FP_GROUPS; g++)
+	{
+		config[g] = 0;
+		weight[g] = 0;
+	}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_is("intel"))
+	{
+		for (g = 0; g < COUNTER_FP_GROUPS; g++)
+		{
+			config[g] = intel[g];
+			weight[g] = intel_weight[g];
+		}
+	}
+	else if (__builtin_cpu_is("amd"))
+	{
+		config[0] = 0xff03;
+		weight[0] = 1;
+	}
+#else
+	(void)intel;
+	(void)intel_weight;
+#endif
+}
+
+/* ************************************************************************ */
+/* counterEnabled: 1 if PARTDIFF_COUNTERS is set (and not 0)                */
+/* ************************************************************************ */
+int
+counterEnabled (void)
+{
+	char const* wanted = getenv("PARTDIFF_COUNTERS");
+
+	return (NULL != wanted && strcmp(wanted, "0") != 0);
+}
+
+#ifdef __linux__
+
+/* ************************************************************************ */
+/* openEvent: counts one event of the calling thread in user space from     */
+/* now on, returns the file descriptor or -1 (errno set)                    */
+/* ************************************************************************ */
+static
+int
+openEvent (unsigned int type, unsigned long long config)
+{
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	/* pid 0, cpu -1: this thread on any processor */
+	return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+#endif
+
+/* ************************************************************************ */
+/* counterStart: opens all events for the calling thread; call it in every  */
+/* thread that is to be measured                                            */
+/* ************************************************************************ */
+void
+counterStart (struct counters* c)
+{
+	int e;
+
+	c->error = 0;
+
+	for (e = 0; e < COUNTER_EVENTS; e++)
+	{
+		c->fd[e] = -1;
+		c->value[e] = -1;
+	}
+
+#ifdef __linux__
+	{
+		unsigned long long config[COUNTER_EVENTS];
+		unsigned int type[COUNTER_EVENTS];
+		int weight[COUNTER_FP_GROUPS];
+
+		type[COUNTER_TASK_CLOCK] = PERF_TYPE_SOFTWARE;
+		config[COUNTER_TASK_CLOCK] = PERF_COUNT_SW_TASK_CLOCK;
+		type[COUNTER_CYCLES] = PERF_TYPE_HARDWARE;
+		config[COUNTER_CYCLES] = PERF_COUNT_HW_CPU_CYCLES;
+		type[COUNTER_INSTRUCTIONS] = PERF_TYPE_HARDWARE;
+		config[COUNTER_INSTRUCTIONS] = PERF_COUNT_HW_INSTRUCTIONS;
+		type[COUNTER_LLC_READS] = PERF_TYPE_HW_CACHE;
+		config[COUNTER_LLC_READS] = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		type[COUNTER_LLC_WRITES] = PERF_TYPE_HW_CACHE;
+		config[COUNTER_LLC_WRITES] = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_WRITE << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+		fpEvents(config + COUNTER_FP, weight);
+
+		for (e = 0; e < COUNTER_EVENTS; e++)
+		{
+			if (e >= COUNTER_FP)
+			{
+				type[e] = PERF_TYPE_RAW;
+
+				/* not used on this CPU: counts nothing */
+				if (weight[e - COUNTER_FP] == 0)
+				{
+					c->value[e] = 0;
+					continue;
+				}
+			}
+
+			c->fd[e] = openEvent(type[e], config[e]);
+
+			if (c->fd[e] < 0 && c->error == 0)
+			{
+				c->error = errno;
+			}
+		}
+	}
+#else
+	c->error = ENOSYS;
+#endif
+}
+
+/* ************************************************************************ */
+/* counterStop: reads and closes the events of the calling thread           */
+/* ************************************************************************ */
+void
+counterStop (struct counters* c)
+{
+#ifdef __linux__
+	int e;
+	long long buf[3];                           /* value, time enabled, time running              */
+
+	for (e = 0; e < COUNTER_EVENTS; e++)
+	{
+		if (c->fd[e] < 0)
+		{
+			continue;
+		}
+
+		if (read(c->fd[e], buf, sizeof(buf)) == (ssize_t)sizeof(buf) && buf[2] > 0)
+		{
+			/* multiplexed: scale up to the time the event was enabled */
+			c->value[e] = (buf[2] < buf[1]) ? (long long)((double)buf[0] * buf[1] / buf[2]) : buf[0];
+		}
+
+		close(c->fd[e]);
+		c->fd[e] = -1;
+	}
+#else
+	(void)c;
+#endif
+}
+
+/* ************************************************************************ */
+/* flops: FLOPs from the FP events, -1 if one of them is missing            */
+/* ************************************************************************ */
+static
+double
+flops (struct counters const* c)
+{
+	unsigned long long config[COUNTER_FP_GROUPS];
+	int weight[COUNTER_FP_GROUPS];
+	int g;
+	double sum = 0;
+
+	fpEvents(config, weight);
+
+	for (g = 0; g < COUNTER_FP_GROUPS; g++)
+	{
+		if (c->value[COUNTER_FP + g] < 0)
+		{
+			return -1;
+		}
+
+		sum += (double)c->value[COUNTER_FP + g] * weight[g];
+	}
+
+	return sum;
+}
+
+/* ************************************************************************ */
+/* printValue: one count, "n/v" if not available                            */
+/* ************************************************************************ */
+static
+void
+printValue (long long value, char const* name)
+{
+	if (value < 0)
+	{
+		printf("n/v %s", name);
+	}
+	else
+	{
+		printf("%.3e %s", (double)value, name);
+	}
+}
+
+/* ************************************************************************ */
+/* counterReport: prints the counts of n threads (or processes, unit) and   */
+/* their sum, and compares the measured FLOPs and the memory traffic (LLC   */
+/* misses times COUNTER_LINE bytes) with the estimate of the program        */
+/* (mflop, over the calculation time seconds)                               */
+/* ************************************************************************ */
+void
+counterReport (struct counters const* c, int n, char const* unit, double mflop, double seconds)
+{
+	int e, t;
+	struct counters sum;
+	double fp;
+	double bytes;
+
+	for (e = 0; e < COUNTER_EVENTS; e++)
+	{
+		sum.value[e] = 0;
+
+		for (t = 0; t < n; t++)
+		{
+			/* not available in one thread: not available at all */
+			sum.value[e] = (c[t].value[e] < 0 || sum.value[e] < 0) ? -1 : sum.value[e] + c[t].value[e];
+		}
+	}
+
+	for (t = 0; t <= n; t++)
+	{
+		struct counters const* x = (t < n) ? &c[t] : &sum;
+
+		/* one thread: no sum */
+		if (t == n && n == 1)
+		{
+			break;
+		}
+
+		if (t < n)
+		{
+			printf("Zaehler %-7s%3d: ", unit, t);
+		}
+		else
+		{
+			printf("Zaehler gesamt:     ");
+		}
+
+		if (x->value[COUNTER_TASK_CLOCK] >= 0)
+		{
+			printf("%.3f s CPU, ", x->value[COUNTER_TASK_CLOCK] * 1e-9);
+		}
+
+		printValue(x->value[COUNTER_CYCLES], "Zyklen, ");
+		printValue(x->value[COUNTER_INSTRUCTIONS], "Instr.");
+
+		if (x->value[COUNTER_CYCLES] > 0 && x->value[COUNTER_INSTRUCTIONS] >= 0)
+		{
+			printf(" (IPC %.2f)", (double)x->value[COUNTER_INSTRUCTIONS] / x->value[COUNTER_CYCLES]);
+		}
+
+		fp = flops(x);
+		printf(", ");
+		printValue((fp < 0) ? -1 : (long long)fp, "Flop, ");
+		printValue(x->value[COUNTER_LLC_READS], "LLC-Misses\n");
+	}
+
+	fp = flops(&sum);
+	bytes = (sum.value[COUNTER_LLC_READS] < 0) ? -1 :
+	        (double)(sum.value[COUNTER_LLC_READS] + ((sum.value[COUNTER_LLC_WRITES] < 0) ? 0 : sum.value[COUNTER_LLC_WRITES])) * COUNTER_LINE;
+
+	printf("Gemessen:           ");
+
+	if (fp >= 0)
+	{
+		printf("%f MFlop (geschaetzt %f), %f MFlop/s", fp * 1e-6, mflop, fp * 1e-6 / seconds);
+	}
+	else
+	{
+		printf("Flop n/v (geschaetzt %f MFlop)", mflop);
+	}
+
+	if (bytes >= 0)
+	{
+		printf(", %f GB/s Speicher (LLC-Misses x %d Byte)", bytes * 1e-9 / seconds, COUNTER_LINE);
+	}
+	else
+	{
+		printf(", Speicher n/v");
+	}
+
+	printf("\n");
+
+	if (c[0].error != 0)
+	{
+		printf("                    perf_event_open: %s (keine PMU oder perf_event_paranoid zu hoch)\n", strerror(c[0].error));
+	}
+}
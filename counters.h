@@ -0,0 +1,59 @@
+/****************************************************************************/
+/****************************************************************************/
+/**                                                                        **/
+/**                TU Muenchen - Institut fuer Informatik                  **/
+/**                                                                        **/
+/** Copyright: Prof. Dr. Thomas Ludwig                                     **/
+/**            Andreas C. Schmidt                                          **/
+/**                                                                        **/
+/** File:      counters.h                                                  **/
+/**                                                                        **/
+/** Purpose:   Hardware performance counters (Linux perf_event_open) per   **/
+/**            thread around calculate(), switched on with the             **/
+/**            environment variable PARTDIFF_COUNTERS=1.                   **/
+/**                                                                        **/
+/****************************************************************************/
+/****************************************************************************/
+
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+/* ************* */
+/* Some defines. */
+/* ************* */
+#define COUNTER_TASK_CLOCK	0	/* ns the thread ran (software event)     */
+#define COUNTER_CYCLES		1
+#define COUNTER_INSTRUCTIONS	2
+#define COUNTER_LLC_READS	3	/* last level cache read misses           */
+#define COUNTER_LLC_WRITES	4	/* last level cache write misses          */
+#define COUNTER_FP		5	/* retired FP instructions by width, 5.. */
+#define COUNTER_FP_GROUPS	5
+#define COUNTER_EVENTS		(COUNTER_FP + COUNTER_FP_GROUPS)
+#define COUNTER_LINE		64	/* bytes per cache miss                   */
+
+/* ************************************************************************ */
+/* The counters of one thread. value[e] is -1 if event e is not available   */
+/* (no PMU, not permitted, unknown CPU); values of multiplexed events are   */
+/* scaled up to the whole measurement.                                      */
+/* ************************************************************************ */
+struct counters
+{
+	int       fd[COUNTER_EVENTS];     /* open events, -1: none                */
+	long long value[COUNTER_EVENTS];  /* counts after counterStop()           */
+	int       error;                  /* errno of the first event that failed */
+};
+
+/* *************************** */
+/* Some function declarations. */
+/* *************************** */
+/* Documentation in counters.c */
+/* *************************** */
+int counterEnabled ( void );
+
+void counterStart ( struct counters* );
+
+void counterStop ( struct counters* );
+
+void counterReport ( struct counters const*, int, char const*, double, double );
+
+#endif
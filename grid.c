@@ -0,0 +1,115 @@
+/****************************************************************************/
+/****************************************************************************/
+/**                                                                        **/
+/**                TU Muenchen - Institut fuer Informatik                  **/
+/**                                                                        **/
+/** Copyright: Prof. Dr. Thomas Ludwig                                     **/
+/**            Andreas C. Schmidt                                          **/
+/**                                                                        **/
+/** File:      grid.c                                                      **/
+/**                                                                        **/
+/** Purpose:   Allocation of the flat matrix storage (see grid.h).         **/
+/**                                                                        **/
+/****************************************************************************/
+/****************************************************************************/
+
+#define _XOPEN_SOURCE 600
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "grid.h"
+
+/* ************************************************************************ */
+/* paddedStride: padded line length for lines of "cols" values of "size"    */
+/* bytes. Lines are rounded up to whole cache lines. A stride that is a     */
+/* multiple of 4 KiB maps all lines of a column onto the same cache sets,   */
+/* so one more cache line is added in that case.                            */
+/* ************************************************************************ */
+static
+int
+paddedStride (int cols, size_t size)
+{
+	int per_line = GRID_ALIGNMENT / size;
+	int stride = ((cols + per_line - 1) / per_line) * per_line;
+
+	if ((stride * size) % 4096 == 0)
+	{
+		stride += per_line;
+	}
+
+	return stride;
+}
+
+/* ************************************************************************ */
+/* alignedBlock: allocates "bytes" bytes on a cache line boundary and quits */
+/* if there was a memory allocation problem                                 */
+/* ************************************************************************ */
+static
+void*
+alignedBlock (size_t bytes)
+{
+	void *p;
+
+	if (posix_memalign(&p, GRID_ALIGNMENT, bytes) != 0)
+	{
+		printf("\n\nSpeicherprobleme!\n");
+		/* exit program */
+		exit(1);
+	}
+
+	return p;
+}
+
+/* ************************************************************************ */
+/* gridStride: returns the padded line length for lines of "cols" doubles   */
+/* ************************************************************************ */
+int
+gridStride (int cols)
+{
+	return paddedStride(cols, sizeof(double));
+}
+
+/* ************************************************************************ */
+/* allocateGrid: allocates an uninitialized grid of rows x cols values      */
+/* and quits if there was a memory allocation problem                       */
+/* ************************************************************************ */
+void
+allocateGrid (struct grid* g, int rows, int cols)
+{
+	g->rows = rows;
+	g->cols = cols;
+	g->stride = gridStride(cols);
+	g->data = alignedBlock((size_t)rows * g->stride * sizeof(double));
+}
+
+/* ************************************************************************ */
+/* freeGrid: frees memory of a grid                                         */
+/* ************************************************************************ */
+void
+freeGrid (struct grid* g)
+{
+	free(g->data);
+	g->data = NULL;
+}
+
+/* ************************************************************************ */
+/* allocateFloatGrid: allocates an uninitialized grid of rows x cols floats */
+/* ************************************************************************ */
+void
+allocateFloatGrid (struct fgrid* g, int rows, int cols)
+{
+	g->rows = rows;
+	g->cols = cols;
+	g->stride = paddedStride(cols, sizeof(float));
+	g->data = alignedBlock((size_t)rows * g->stride * sizeof(float));
+}
+
+/* ************************************************************************ */
+/* freeFloatGrid: frees memory of a float grid                              */
+/* ************************************************************************ */
+void
+freeFloatGrid (struct fgrid* g)
+{
+	free(g->data);
+	g->data = NULL;
+}
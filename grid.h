@@ -0,0 +1,71 @@
+/****************************************************************************/
+/****************************************************************************/
+/**                                                                        **/
+/**                TU Muenchen - Institut fuer Informatik                  **/
+/**                                                                        **/
+/** Copyright: Prof. Dr. Thomas Ludwig                                     **/
+/**            Andreas C. Schmidt                                          **/
+/**                                                                        **/
+/** File:      grid.h                                                      **/
+/**                                                                        **/
+/** Purpose:   Flat, cache line aligned storage for the matrices of all    **/
+/**            solver variants, in double and (mixed precision) in float.  **/
+/**                                                                        **/
+/****************************************************************************/
+/****************************************************************************/
+
+#ifndef GRID_H
+#define GRID_H
+
+#include <stddef.h>
+
+/* ************* */
+/* Some defines. */
+/* ************* */
+#define GRID_ALIGNMENT		64	/* cache line size in bytes               */
+
+/* ************************************************************************ */
+/* A grid is one matrix stored line by line in a single memory block.       */
+/* Every line starts on a cache line boundary, the lines are padded up to   */
+/* "stride" values. Element (i,j) is data[i * stride + j].                  */
+/* ************************************************************************ */
+struct grid
+{
+	int     rows;           /* number of lines                                */
+	int     cols;           /* number of values used per line                 */
+	int     stride;         /* distance of two lines in values (padded)       */
+	double  *data;          /* first value of line 0                          */
+};
+
+/* The same layout with float values (mixed precision). GRID and GRID_LINE  */
+/* work for both.                                                           */
+struct fgrid
+{
+	int     rows;           /* number of lines                                */
+	int     cols;           /* number of values used per line                 */
+	int     stride;         /* distance of two lines in values (padded)       */
+	float   *data;          /* first value of line 0                          */
+};
+
+/* Access element (i,j) of grid g */
+#define GRID(g, i, j)		((g)->data[(size_t)(i) * (g)->stride + (j)])
+
+/* Pointer to the first value of line i of grid g */
+#define GRID_LINE(g, i)		((g)->data + (size_t)(i) * (g)->stride)
+
+/* *************************** */
+/* Some function declarations. */
+/* *************************** */
+/* Documentation in grid.c     */
+/* *************************** */
+int gridStride ( int );
+
+void allocateGrid ( struct grid*, int, int );
+
+void freeGrid ( struct grid* );
+
+void allocateFloatGrid ( struct fgrid*, int, int );
+
+void freeFloatGrid ( struct fgrid* );
+
+#endif
@@ -40,8 +40,11 @@
 /****************************************************************************/
 /** int *method;                                                           **/
 /**         Bezeichnet das bei der L"osung der Poissongleichung zu         **/
-/**         verwendende Verfahren ( Gauss-Seidel oder Jacobi ).            **/
-/** Werte:  METH_GAUSS_SEIDEL  oder METH_JACOBI (definierte Konstanten)    **/
+/**         verwendende Verfahren ( Gauss-Seidel, Jacobi, Gauss-Seidel in  **/
+/**         Rot-Schwarz-Reihenfolge, konjugierte Gradienten oder SOR in    **/
+/**         Rot-Schwarz-Reihenfolge ).                                     **/
+/** Werte:  METH_GAUSS_SEIDEL, METH_JACOBI, METH_RED_BLACK, METH_CG oder **/
+/**         METH_SOR                                                       **/
 /****************************************************************************/
 /** int *interlines:                                                       **/
 /**         Gibt die Zwischenzeilen zwischen den auszugebenden             **/
@@ -71,6 +74,22 @@
 /**         Es wird jeweils nur einer der beiden Parameter f"ur die        **/
 /**         Abbruchbedingung eingelesen.                                   **/
 /****************************************************************************/
+/** double omega:                                                          **/
+/**         Optional, nur f"ur METH_SOR, auf der Kommandozeile nach den    **/
+/**         sechs Parametern: --omega=<wert>, 0 < wert < 2. Ohne die       **/
+/**         Option (0) wird der optimale Faktor 2/(1+sin(pi h)) aus der    **/
+/**         Maschenweite h berechnet.                                      **/
+/****************************************************************************/
+/** int roofline:                                                         **/
+/**         Optional: --roofline misst vor der Rechnung Speicherbandbreite **/
+/**         und Spitzenleistung aller Prozesse und vergleicht die Rechnung **/
+/**         in der Statistik damit (Roofline).                             **/
+/****************************************************************************/
+/** int adaptive:                                                          **/
+/**         Optional: --residual=adaptive reduziert das Residuum nur alle  **/
+/**         paar Iterationen, der Abstand folgt aus der beobachteten       **/
+/**         Konvergenz (residual.c); --residual=always jede (Vorgabe).     **/
+/****************************************************************************/
 
 #include "partdiff-par.h"
 #include <string.h>
@@ -89,10 +108,14 @@ void AskParams( struct options* options, int argc, char** argv )
   //int rank = 42;
   //MPI_Comm_rank(MPI_COMM_WORLD,&rank);
   //printf("test%d\n",rank);
+  int i;
   int mpi_size = 0;
   int mpi_rank = 0;
   MPI_Comm_size(MPI_COMM_WORLD,&mpi_size);
   MPI_Comm_rank(MPI_COMM_WORLD,&mpi_rank);
+  options->omega = 0;
+  options->roofline = 0;
+  options->adaptive = 0;
   if (0 == mpi_rank)
   {
 	if( argc < 2 ) // if there is only the programm call and no options
@@ -116,11 +139,15 @@ void AskParams( struct options* options, int argc, char** argv )
 			printf( "Select calculationmethod:\n");
 			printf( "  %1d: Gauss-Seidel.\n", METH_GAUSS_SEIDEL);
 			printf( "  %1d: Jacobi.\n",       METH_JACOBI);
+			printf( "  %1d: Gauss-Seidel (red-black).\n", METH_RED_BLACK);
+			printf( "  %1d: Conjugate gradients.\n", METH_CG);
+			printf( "  %1d: SOR (red-black).\n", METH_SOR);
 			printf( "method> ");
 			fflush( stdout );
 			ret = scanf("%d", &(options->method));
 		}
-		while ( (options->method < METH_GAUSS_SEIDEL) || (options->method > METH_JACOBI) );
+		while ( (options->method < METH_GAUSS_SEIDEL) ||
+		        (options->method > METH_RED_BLACK && options->method != METH_CG && options->method != METH_SOR) );
 		do
 		{
 			printf ( "\n" );
@@ -191,10 +218,13 @@ void AskParams( struct options* options, int argc, char** argv )
 		    argc < 7)
 		{
 			printf("\nUsage:\n");
-			printf("partdiff [num] [method] [lines] [func] [term] [prec/iter]\n");
+			printf("partdiff [num] [method] [lines] [func] [term] [prec/iter] [--omega=<value>] [--roofline] [--residual=adaptive|always]\n");
 			printf("  - num:    number of threads to use\n");
 			printf("  - method: %1d: Gauss-Seidel.\n", METH_GAUSS_SEIDEL);
 			printf("            %1d: Jacobi.\n",       METH_JACOBI);
+			printf("            %1d: Gauss-Seidel (red-black).\n", METH_RED_BLACK);
+			printf("            %1d: Conjugate gradients.\n", METH_CG);
+			printf("            %1d: SOR (red-black).\n", METH_SOR);
 			printf("  - lines:  (lines=interlines) matrixsize = interlines*8+9\n");
 			printf("  - func:   %1d: f(x,y)=0.\n",                        FUNC_F0);
 			printf("            %1d: f(x,y)=2pi^2*sin(pi*x)sin(pi*y).\n", FUNC_FPISIN);
@@ -203,6 +233,9 @@ void AskParams( struct options* options, int argc, char** argv )
 			printf("  - prec/iter: depending on term:\n");
 			printf("            precision:  Range: 1e-4 .. 1e-20.\n");
 			printf("            iterations: Range: 1 .. %d.\n", MAX_ITERATION );
+			printf("  - --omega: SOR relaxation factor, default 2/(1+sin(pi h))\n");
+			printf("  - --roofline: measure bandwidth and peak, compare the solver with them\n");
+			printf("  - --residual: adaptive: reduce the residuum only every few iterations\n");
 			printf("\n");
 			printf("Example: %s 1 2 100 1 2 100 \n", argv[0]);
 			exit(0);
@@ -225,13 +258,53 @@ void AskParams( struct options* options, int argc, char** argv )
 			sscanf( argv[6],"%d", &(options->term_iteration));
 			options->term_precision = 0;
 		}
+
+		if ((options->method < METH_GAUSS_SEIDEL) ||
+		    (options->method > METH_RED_BLACK && options->method != METH_CG && options->method != METH_SOR))
+		{
+			printf("Method %d is not available in partdiff-par\n", options->method);
+			MPI_Abort(MPI_COMM_WORLD, 1);
+		}
+
+		/* optional parameters: --name=value */
+		for (i = 7; i < argc; i++)
+		{
+			if (strcmp(argv[i], "--roofline") == 0)
+			{
+				options->roofline = 1;
+			}
+			else if (strcmp(argv[i], "--residual=adaptive") == 0 || strcmp(argv[i], "--residual=always") == 0)
+			{
+				options->adaptive = (strcmp(argv[i], "--residual=adaptive") == 0);
+			}
+			else if (strncmp(argv[i], "--omega=", 8) == 0)
+			{
+				if (sscanf(argv[i] + 8, "%lf", &(options->omega)) != 1 ||
+				    options->omega <= 0 || options->omega >= 2)
+				{
+					printf("SOR needs --omega=<value> with 0 < value < 2: %s\n", argv[i]);
+					MPI_Abort(MPI_COMM_WORLD, 1);
+				}
+			}
+			else if (strncmp(argv[i], "--precision=", 12) == 0 || strncmp(argv[i], "--affinity=", 11) == 0 ||
+			         strncmp(argv[i], "--smoother=", 11) == 0 || strncmp(argv[i], "--cycle=", 8) == 0)
+			{
+				printf("%s nur in partdiff-seq und partdiff-openmp.\n", argv[i]);
+				MPI_Abort(MPI_COMM_WORLD, 1);
+			}
+			else
+			{
+				printf("Unknown option %s\n", argv[i]);
+				MPI_Abort(MPI_COMM_WORLD, 1);
+			}
+		}
 	}
 }
 	MPI_Datatype Options_type;
-	MPI_Datatype type[7] = {MPI_INT,MPI_INT,MPI_INT,MPI_INT,MPI_INT,MPI_INT,MPI_DOUBLE};
-	int blocklen[7] = {1,1,1,1,1,1,1};
-	MPI_Aint disp[7];
-	MPI_Aint options_address, number_address, method_address, interlines_address, inf_func_address, termination_address, term_iteration_address, term_precision_address;
+	MPI_Datatype type[10] = {MPI_INT,MPI_INT,MPI_INT,MPI_INT,MPI_INT,MPI_INT,MPI_DOUBLE,MPI_DOUBLE,MPI_INT,MPI_INT};
+	int blocklen[10] = {1,1,1,1,1,1,1,1,1,1};
+	MPI_Aint disp[10];
+	MPI_Aint options_address, number_address, method_address, interlines_address, inf_func_address, termination_address, term_iteration_address, term_precision_address, omega_address, roofline_address, adaptive_address;
 	MPI_Get_address(options,&options_address);
 	MPI_Get_address(&(options->number),&number_address);
 	MPI_Get_address(&(options->method),&method_address);
@@ -240,6 +313,9 @@ void AskParams( struct options* options, int argc, char** argv )
 	MPI_Get_address(&(options->termination),&termination_address);
 	MPI_Get_address(&(options->term_iteration),&term_iteration_address);
 	MPI_Get_address(&(options->term_precision),&term_precision_address);
+	MPI_Get_address(&(options->omega),&omega_address);
+	MPI_Get_address(&(options->roofline),&roofline_address);
+	MPI_Get_address(&(options->adaptive),&adaptive_address);
 	disp[0]  = number_address - options_address;
 	disp[1]  = method_address - options_address;
 	disp[2]  = interlines_address - options_address;
@@ -247,7 +323,10 @@ void AskParams( struct options* options, int argc, char** argv )
 	disp[4]  = termination_address - options_address;
 	disp[5]  = term_iteration_address - options_address;
 	disp[6]  = term_precision_address - options_address;
-	MPI_Type_create_struct(7, blocklen, disp, type,&Options_type);
+	disp[7]  = omega_address - options_address;
+	disp[8]  = roofline_address - options_address;
+	disp[9]  = adaptive_address - options_address;
+	MPI_Type_create_struct(10, blocklen, disp, type,&Options_type);
 	MPI_Type_commit(&Options_type);
 MPI_Bcast(options, 1,Options_type,0,MPI_COMM_WORLD);
 }
@@ -20,10 +20,17 @@
 /* ************************************************************************ */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <malloc.h>
 #include <sys/time.h>
 #include "partdiff-par.h"
+#include "stencil.h"
+#include "counters.h"
+#include "roofline.h"
+#include "trace.h"
+#include "clocksync.h"
+#include "residual.h"
 //#include <omp.h>
 #include <mpi.h>
 
@@ -31,9 +38,12 @@ struct calculation_arguments
 {
   int     N;              /* number of spaces between lines (lines=N+1)     */
   int     num_matrices;   /* number of matrices                             */
-  double  ***Matrix;      /* index matrix used for addressing M             */
-  double  *M;             /* two matrices with real values                  */
+  struct grid Matrix[2];  /* two matrices with the own lines and halos      */
+  struct grid Samples;    /* 9x9 points of DisplayMatrix, on rank 0 only    */
+  struct grid Func;       /* forcing term without line factor (initFunction) */
+  struct grid FuncScale;  /* line factors of the forcing term               */
   double  h;              /* length of a space between two lines            */
+  double  omega;          /* SOR: relaxation factor                         */
 };
 
 struct calculation_results
@@ -46,13 +56,48 @@ struct calculation_results
 struct mpi_stats
 {
   int worldsize;			/* Size of Comm_WORLD */
-  int rank;                             /* Rank of Node in Comm_WORLD */
-  int ghostlines;			/* Number of ghostlines (overlapping lines) */
-  int localN;
-  int *counts;
-  int *displ;
-  int *glines;
-  int bignode;           /* Boolean! Does the Node calculate an extra line. */
+  int rank;                             /* Rank of Node in comm */
+  MPI_Comm comm;                        /* cartesian communicator of dims[0] x dims[1] nodes */
+  int dims[2];                          /* nodes per column and per line of the node grid */
+  int coords[2];                        /* position of this node in the node grid */
+  int up, down, left, right;            /* neighbours, MPI_PROC_NULL at the border of the matrix */
+  int first;                            /* global index of the first own line */
+  int localN;                           /* number of own lines */
+  int firstcol;                         /* global index of the first own column */
+  int localM;                           /* number of own columns */
+  MPI_Datatype column;                  /* one column of the own lines (ghostcolumns) */
+  int blocking;                         /* ghostlines with MPI_Sendrecv (PARTDIFF_HALO=blocking) */
+};
+
+/* ************************************************************************ */
+/* A checkpoint file starts with this header (CHECKPOINT_OFFSET bytes      */
+/* reserved), followed by the whole matrix of N+1 x N+1 values line by      */
+/* line, independent of the number of nodes and the decomposition.          */
+/* ************************************************************************ */
+struct checkpoint_header
+{
+  char    magic[8];       /* CHECKPOINT_MAGIC                               */
+  int     N;              /* number of spaces between lines                 */
+  int     method;         /* options at the time of the checkpoint          */
+  int     interlines;
+  int     inf_func;
+  int     termination;
+  int     term_iteration; /* TERM_ITER: iterations still to do              */
+  double  term_precision;
+  double  omega;          /* SOR: --omega, 0: automatic                     */
+  int     stat_iteration; /* iterations done                                */
+  double  stat_precision; /* TERM_PREC: residuum of the last iteration      */
+};
+
+struct checkpoint
+{
+  char const* file;                     /* write checkpoints to this file (PARTDIFF_CHECKPOINT) */
+  char const* restart;                  /* continue from this file (PARTDIFF_RESTART) */
+  int interval;                         /* iterations between two checkpoints (PARTDIFF_CHECKPOINT_INTERVAL) */
+  struct checkpoint_header header;      /* header read for the restart */
+  int count;                            /* number of checkpoints written */
+  double time;                          /* seconds spent writing them */
+  double bytes;                         /* bytes written */
 };
 
 /* ************************************************************************ */
@@ -63,6 +108,13 @@ struct mpi_stats
 struct timeval start_time;       /* time when program started                      */
 struct timeval comp_time;        /* time when calculation completed                */
 struct mpi_stats mpis;		     /* mpi values of specific node and etire com*/
+struct checkpoint ckpt;		     /* checkpoint and restart                        */
+struct counters* counters = NULL; /* around calculate(), rank 0: of all processes    */
+struct roofline* roofline = NULL; /* --roofline probes, rank 0: of all processes     */
+struct clocksync* clocks = NULL;  /* offset and drift of this clock to rank 0        */
+double* timeline = NULL;          /* start, end of calculate() on the clock of rank */
+                                  /* 0 and uncertainty, rank 0: of all processes     */
+struct residual residual;        /* evaluations of the residuum (--residual)       */
 
 /* ************************************************************************ */
 /* initVariables: Initializes some global variables                         */
@@ -72,9 +124,16 @@ void
 initVariables (struct calculation_arguments* arguments, struct calculation_results* results, struct options* options)
 {
   arguments->N = options->interlines * 8 + 9 - 1; /* magic numbers... why "* 8 + 9 - 1" */
-  arguments->num_matrices = (options->method == METH_JACOBI) ? 2 : 1;
+  /* Gauss-Seidel with TERM_PREC keeps a copy of the own lines in Matrix[1] */
+  arguments->num_matrices = (options->method == METH_JACOBI ||
+                             (options->method == METH_GAUSS_SEIDEL && options->termination == TERM_PREC)) ? 2 : 1;
   arguments->h = (float)( ( (float)(1) ) / (arguments->N));
+
+  /* SOR: --omega or the optimal factor of the model problem, 2/(1+sin(pi h)) */
+  arguments->omega = (options->omega > 0) ? options->omega : 2.0 / (1.0 + sin(PI * arguments->h));
   
+  arguments->Func.data = NULL;
+
   results->m = 0;
   results->stat_iteration = 0;
   results->stat_precision = 0;
@@ -91,39 +150,30 @@ freeMatrices (struct calculation_arguments* arguments)
   
   for (i = 0; i < arguments->num_matrices; i++)
   {
-    free(arguments->Matrix[i]);
+    freeGrid(&arguments->Matrix[i]);
   }
   
-  free(arguments->Matrix);
-  free(arguments->M);
+  if (0 == mpis.rank)
+  {
+    freeGrid(&arguments->Samples);
+  }
+
+  if (NULL != arguments->Func.data)
+  {
+    freeGrid(&arguments->Func);
+    freeGrid(&arguments->FuncScale);
+  }
 }
 
 /* ************************************************************************ */
-/* freeMPI: frees memory for matrices of MPIstats                           */
+/* freeMPI: frees the communicator and datatype of MPIstats                 */
 /* ************************************************************************ */
 static
 void
 freeMPI (struct mpi_stats* mpis)
 {
-  free(mpis->counts);
-  free(mpis->displ);
-  free(mpis->glines);
-}
-
-/* ********************************************************************************* */
-/* isBignode: returns as boolean wether the given node has to calculate a line more. */
-/* ********************************************************************************* */
-static int isBignode(int node, struct calculation_arguments* arguments)
-{
-  int result = 0;
-  if (((arguments->N % mpis.worldsize) >= (node+1))&&(1 != mpis.worldsize))
-  {
-    result = 1;
-  }else if(((arguments->N % mpis.worldsize) < (node+1))||(1 == mpis.worldsize))
-  {
-    result = 0;
-  }
-  return result;
+  MPI_Type_free(&mpis->column);
+  MPI_Comm_free(&mpis->comm);
 }
 
 /* ************************************************************************ */
@@ -146,207 +196,1126 @@ allocateMemory (size_t size)
   return p;
 }
 
-/* ************************************************************************ */
-/* allocateMatrices: allocates memory for matrices                          */
-/* ************************************************************************ */
-static
-void
-allocateMatrices (struct calculation_arguments* arguments)
-{
-  int i, j;
-  int N = arguments->N;
-  //On the master-node the complete matrix is beeing allocated!
-  if (0 == mpis.rank)
-  {
-    arguments->M = allocateMemory(arguments->num_matrices * (N + 1) * (N + 1) * sizeof(double));
-    arguments->Matrix = allocateMemory(arguments->num_matrices * sizeof(double**));
-    for (i = 0; i < arguments->num_matrices; i++)
+/* ************************************************************************ */
+/* allocateMatrices: allocates memory for matrices                          */
+/* ************************************************************************ */
+static
+void
+allocateMatrices (struct calculation_arguments* arguments)
+{
+  int i;
+
+  /* every node holds its own block plus one halo line (column) on each side */
+  for (i = 0; i < arguments->num_matrices; i++)
+  {
+    allocateGrid(&arguments->Matrix[i], mpis.localN + 2, mpis.localM + 2);
+  }
+
+  /* the master-node only collects the points that are displayed */
+  if (0 == mpis.rank)
+  {
+    allocateGrid(&arguments->Samples, 9, 9);
+  }
+}
+
+/* ************************************************************************ */
+/* initMatrices: Initialize matrix/matrices and some global variables       */
+/* Local point (i,j) is global point (first-1+i, firstcol-1+j); the halos   */
+/* are initialized as well, so they are valid before the first exchange.   */
+/* ************************************************************************ */
+static
+void
+initMatrices (struct calculation_arguments* arguments, struct options* options)
+{
+  int g, i, j;                                /*  local variables for loops   */
+  int gi, gj;                                 /*  global indices              */
+  int N = arguments->N;
+  int lN = mpis.localN;
+  int lM = mpis.localM;
+  double h = arguments->h;
+  double value;
+  struct grid* Matrix = arguments->Matrix;
+
+  for (g = 0; g < arguments->num_matrices; g++)
+  {
+    for (i = 0; i <= lN + 1; i++)
+    {
+      gi = mpis.first - 1 + i;
+
+      for (j = 0; j <= lM + 1; j++)
+      {
+        gj = mpis.firstcol - 1 + j;
+
+        /* initialize matrix/matrices with zeros */
+        value = 0;
+
+        /* initialize borders, depending on function (function 2: nothing to do) */
+        if (options->inf_func == FUNC_F0)
+        {
+          if (0 == gi)
+          {
+            value = 1 - (h * gj);
+          }
+          else if (N == gi)
+          {
+            value = h * gj;
+          }
+          else if (0 == gj)
+          {
+            value = 1 - (h * gi);
+          }
+          else if (N == gj)
+          {
+            value = h * gi;
+          }
+
+          /* set the corners to zero */
+          if ((0 == gi && N == gj) || (N == gi && 0 == gj))
+          {
+            value = 0;
+          }
+        }
+
+        GRID(&Matrix[g], i, j) = value;
+      }
+    }
+  }
+}
+
+
+/* ************************************************************************ */
+/* initFunction: precomputes the forcing term of FUNC_FPISIN for the own    */
+/* block and halos (local point (i,j) is global (first-1+i, firstcol-1+j)). */
+/* The forcing term of point (i,j) is                                       */
+/*     Func(i,j) * FuncScale(i)     table, for small grids                  */
+/*     Func(0,j) * FuncScale(i)     separable, for large grids              */
+/* ************************************************************************ */
+static
+void
+initFunction (struct calculation_arguments* arguments, struct options* options)
+{
+  int i, j;
+  int lines = mpis.localN + 2;
+  int cols = mpis.localM + 2;
+  double h = arguments->h;
+  struct grid* Func = &arguments->Func;
+  double* scale;
+
+  if (options->inf_func != FUNC_FPISIN)
+  {
+    return;
+  }
+
+  allocateGrid(&arguments->FuncScale, 1, lines);
+  scale = GRID_LINE(&arguments->FuncScale, 0);
+
+  if ((size_t)lines * gridStride(cols) * sizeof(double) <= FUNC_TABLE_MAX)
+  {
+    allocateGrid(Func, lines, cols);
+
+    for (i = 0; i < lines; i++)
+    {
+      scale[i] = 1.0;
+
+      for (j = 0; j < cols; j++)
+      {
+        GRID(Func, i, j) = TWO_PI_SQUARE * sin((double)(mpis.firstcol - 1 + j) * PI * h) * sin((double)(mpis.first - 1 + i) * PI * h) * h * h * 0.25;
+      }
+    }
+  }
+  else
+  {
+    allocateGrid(Func, 1, cols);
+
+    for (i = 0; i < lines; i++)
+    {
+      scale[i] = sin((double)(mpis.first - 1 + i) * PI * h);
+    }
+    for (j = 0; j < cols; j++)
+    {
+      GRID(Func, 0, j) = TWO_PI_SQUARE * sin((double)(mpis.firstcol - 1 + j) * PI * h) * h * h * 0.25;
+    }
+  }
+}
+
+/* ************************************************************************ */
+/* exchangeGhostlines: sends the first and last own line and column of g to */
+/* the neighbours and receives theirs into the ghostlines 0 and lN+1 and    */
+/* the ghostcolumns 0 and lM+1. Columns are sent with the vector type       */
+/* mpis.column, no packing. Blocking variant, only used with                */
+/* PARTDIFF_HALO=blocking: first all lines go down, then up, then all       */
+/* columns go right, then left (MPI_Sendrecv, so large lines cannot         */
+/* deadlock), the nodes wait for each other along the node grid.            */
+/* ************************************************************************ */
+static
+void
+exchangeGhostlines (struct grid* g)
+{
+  int lN = mpis.localN;
+  int lM = mpis.localM;
+
+  MPI_Sendrecv(&GRID(g, lN, 1), lM, MPI_DOUBLE, mpis.down, 1,
+               &GRID(g, 0, 1), lM, MPI_DOUBLE, mpis.up, 1, mpis.comm, MPI_STATUS_IGNORE);
+  MPI_Sendrecv(&GRID(g, 1, 1), lM, MPI_DOUBLE, mpis.up, 1,
+               &GRID(g, lN + 1, 1), lM, MPI_DOUBLE, mpis.down, 1, mpis.comm, MPI_STATUS_IGNORE);
+  MPI_Sendrecv(&GRID(g, 1, lM), 1, mpis.column, mpis.right, 2,
+               &GRID(g, 1, 0), 1, mpis.column, mpis.left, 2, mpis.comm, MPI_STATUS_IGNORE);
+  MPI_Sendrecv(&GRID(g, 1, 1), 1, mpis.column, mpis.left, 2,
+               &GRID(g, 1, lM + 1), 1, mpis.column, mpis.right, 2, mpis.comm, MPI_STATUS_IGNORE);
+}
+
+/* ************************************************************************ */
+/* distribute: distributes the n inner lines (or columns) 1..n on "parts"   */
+/* nodes, the first n % parts nodes get one more. Returns first and count   */
+/* of node "index".                                                         */
+/* ************************************************************************ */
+static
+void
+distribute (int n, int parts, int index, int* first, int* count)
+{
+  *count = n / parts + ((index < n % parts) ? 1 : 0);
+  *first = 1 + index * (n / parts) + ((index < n % parts) ? index : n % parts);
+}
+
+/* ************************************************************************ */
+/* blockOf: global lines r0..r1 and columns c0..c1 of the node at coords,   */
+/* including the border of the matrix at the edge of the node grid          */
+/* ************************************************************************ */
+static
+void
+blockOf (int const* coords, int N, int* r0, int* r1, int* c0, int* c1)
+{
+  int first, count;
+
+  distribute(N - 1, mpis.dims[0], coords[0], &first, &count);
+  *r0 = (0 == coords[0]) ? 0 : first;
+  *r1 = (mpis.dims[0] - 1 == coords[0]) ? N : first + count - 1;
+
+  distribute(N - 1, mpis.dims[1], coords[1], &first, &count);
+  *c0 = (0 == coords[1]) ? 0 : first;
+  *c1 = (mpis.dims[1] - 1 == coords[1]) ? N : first + count - 1;
+}
+
+/* ************************************************************************ */
+/* checkpointTypes: file type of the global lines r0..r0+rows-1 and columns */
+/* c0..c0+cols-1 in the matrix of a checkpoint file and memory type of the  */
+/* same points in the local grid, starting at local point (i0,j0)           */
+/* ************************************************************************ */
+static
+void
+checkpointTypes (int N, struct grid* g, int r0, int c0, int rows, int cols, int i0, int j0,
+                 MPI_Datatype* filetype, MPI_Datatype* memtype)
+{
+  int sizes[2] = { rows, cols };
+  int gsizes[2] = { N + 1, N + 1 };
+  int gstarts[2] = { r0, c0 };
+  int msizes[2] = { g->rows, g->stride };
+  int mstarts[2] = { i0, j0 };
+
+  MPI_Type_create_subarray(2, gsizes, sizes, gstarts, MPI_ORDER_C, MPI_DOUBLE, filetype);
+  MPI_Type_create_subarray(2, msizes, sizes, mstarts, MPI_ORDER_C, MPI_DOUBLE, memtype);
+  MPI_Type_commit(filetype);
+  MPI_Type_commit(memtype);
+}
+
+/* ************************************************************************ */
+/* writeCheckpoint: writes the options, the iteration counter and the      */
+/* matrix Matrix[m] to the checkpoint file, collectively with MPI-IO.       */
+/* Every node writes its block including the border of the matrix          */
+/* (blockOf), so every point of the matrix is written exactly once. The     */
+/* file is written as <file>.tmp and then renamed, a crash while writing    */
+/* leaves the last checkpoint intact. Only the iterate is saved: the other  */
+/* Jacobi matrix is overwritten completely by the next iteration.           */
+/* ************************************************************************ */
+static
+void
+writeCheckpoint (struct calculation_arguments* arguments, struct calculation_results* results,
+                 struct options* options, int m)
+{
+  int N = arguments->N;
+  int r0, r1, c0, c1;
+  char tmp[1024];
+  double start = MPI_Wtime();
+  struct checkpoint_header header;
+  MPI_Datatype filetype, memtype;
+  MPI_File fh;
+
+  blockOf(mpis.coords, N, &r0, &r1, &c0, &c1);
+  checkpointTypes(N, &arguments->Matrix[m], r0, c0, r1 - r0 + 1, c1 - c0 + 1,
+                  r0 - mpis.first + 1, c0 - mpis.firstcol + 1, &filetype, &memtype);
+
+  snprintf(tmp, sizeof(tmp), "%s.tmp", ckpt.file);
+
+  if (MPI_SUCCESS != MPI_File_open(mpis.comm, tmp, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh))
+  {
+    if (0 == mpis.rank)
+    {
+      printf("Checkpoint-Datei %s kann nicht geschrieben werden.\n", tmp);
+    }
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+
+  if (0 == mpis.rank)
+  {
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.N = N;
+    header.method = options->method;
+    header.interlines = options->interlines;
+    header.inf_func = options->inf_func;
+    header.termination = options->termination;
+    header.term_iteration = options->term_iteration;
+    header.term_precision = options->term_precision;
+    header.omega = options->omega;
+    header.stat_iteration = results->stat_iteration;
+    header.stat_precision = results->stat_precision;
+
+    MPI_File_write_at(fh, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE);
+  }
+
+  MPI_File_set_view(fh, CHECKPOINT_OFFSET, MPI_DOUBLE, filetype, "native", MPI_INFO_NULL);
+  MPI_File_write_all(fh, arguments->Matrix[m].data, 1, memtype, MPI_STATUS_IGNORE);
+  MPI_File_close(&fh);
+
+  if (0 == mpis.rank && 0 != rename(tmp, ckpt.file))
+  {
+    printf("Checkpoint-Datei %s kann nicht umbenannt werden.\n", tmp);
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+
+  /* nobody may open <file>.tmp again before it was renamed */
+  MPI_Barrier(mpis.comm);
+
+  MPI_Type_free(&filetype);
+  MPI_Type_free(&memtype);
+
+  ckpt.count++;
+  ckpt.time += MPI_Wtime() - start;
+  ckpt.bytes += CHECKPOINT_OFFSET + (double)(N + 1) * (N + 1) * sizeof(double);
+}
+
+/* ************************************************************************ */
+/* checkpointDue: 1 if a checkpoint interval ended during the last n        */
+/* iterations and checkpoints are written at all                            */
+/* ************************************************************************ */
+static
+int
+checkpointDue (struct calculation_results* results, int n)
+{
+  return NULL != ckpt.file &&
+         results->stat_iteration / ckpt.interval != (results->stat_iteration - n) / ckpt.interval;
+}
+
+/* ************************************************************************ */
+/* initCheckpoint: reads the environment variables PARTDIFF_CHECKPOINT,     */
+/* PARTDIFF_CHECKPOINT_INTERVAL and PARTDIFF_RESTART. For a restart the     */
+/* header of the checkpoint is read and its options replace the given       */
+/* ones. Called before initMPI, the matrix size is taken from the header.   */
+/* ************************************************************************ */
+static
+void
+initCheckpoint (struct options* options)
+{
+  int rank;
+  char const* interval = getenv("PARTDIFF_CHECKPOINT_INTERVAL");
+  struct checkpoint_header* header = &ckpt.header;
+  MPI_File fh;
+
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  ckpt.file = getenv("PARTDIFF_CHECKPOINT");
+  ckpt.restart = getenv("PARTDIFF_RESTART");
+  ckpt.interval = (NULL != interval) ? atoi(interval) : CHECKPOINT_INTERVAL;
+  ckpt.interval = (ckpt.interval < 1) ? 1 : ckpt.interval;
+
+  if (NULL == ckpt.restart)
+  {
+    return;
+  }
+
+  if (MPI_SUCCESS != MPI_File_open(MPI_COMM_WORLD, (char*)ckpt.restart, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh))
+  {
+    if (0 == rank)
+    {
+      printf("Checkpoint-Datei %s kann nicht gelesen werden.\n", ckpt.restart);
+    }
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+
+  MPI_File_read_at_all(fh, 0, header, sizeof(*header), MPI_BYTE, MPI_STATUS_IGNORE);
+  MPI_File_close(&fh);
+
+  if (0 != memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic)) ||
+      header->N != header->interlines * 8 + 8)
+  {
+    if (0 == rank)
+    {
+      printf("%s ist keine Checkpoint-Datei.\n", ckpt.restart);
+    }
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+
+  options->method = header->method;
+  options->interlines = header->interlines;
+  options->inf_func = header->inf_func;
+  options->termination = header->termination;
+  options->term_iteration = header->term_iteration;
+  options->term_precision = header->term_precision;
+  options->omega = header->omega;
+}
+
+/* ************************************************************************ */
+/* readCheckpoint: reads the own block and its halos from the checkpoint    */
+/* file into every matrix and continues the iteration counter. Any number   */
+/* of nodes and any decomposition can read the file.                        */
+/* ************************************************************************ */
+static
+void
+readCheckpoint (struct calculation_arguments* arguments, struct calculation_results* results)
+{
+  int g;
+  MPI_Datatype filetype, memtype;
+  MPI_File fh;
+
+  checkpointTypes(arguments->N, &arguments->Matrix[0], mpis.first - 1, mpis.firstcol - 1,
+                  mpis.localN + 2, mpis.localM + 2, 0, 0, &filetype, &memtype);
+
+  MPI_File_open(mpis.comm, (char*)ckpt.restart, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh);
+  MPI_File_set_view(fh, CHECKPOINT_OFFSET, MPI_DOUBLE, filetype, "native", MPI_INFO_NULL);
+
+  for (g = 0; g < arguments->num_matrices; g++)
+  {
+    MPI_File_read_at_all(fh, 0, arguments->Matrix[g].data, 1, memtype, MPI_STATUS_IGNORE);
+  }
+
+  MPI_File_close(&fh);
+  MPI_Type_free(&filetype);
+  MPI_Type_free(&memtype);
+
+  results->stat_iteration = ckpt.header.stat_iteration;
+  results->stat_precision = ckpt.header.stat_precision;
+}
+
+/* ************************************************************************ */
+/* pipelineGaussSeidel: performs "iterations" Gauss-Seidel iterations on    */
+/* the own block. A node starts iteration t as soon as the nodes above and  */
+/* to the left have sent their last line and column of iteration t; the    */
+/* ghostline below and the ghostcolumn to the right are the first line and  */
+/* column of the neighbours of iteration t-1. So the iterations are handed  */
+/* over the node grid as a wavefront, several iterations are in flight at   */
+/* the same time and the result is exactly the one of the sequential        */
+/* program.                                                                 */
+/* The maximum residuum of every iteration on this node is stored in        */
+/* residuals (if not NULL), the one of the last iteration is returned.      */
+/* ************************************************************************ */
+static
+double
+pipelineGaussSeidel (struct calculation_arguments* arguments, struct options* options, int iterations, double* residuals)
+{
+  int i, t;
+  int lN = mpis.localN;
+  int lM = mpis.localM;
+  struct grid* Matrix = &arguments->Matrix[0];
+  MPI_Request sends[4] = { MPI_REQUEST_NULL, MPI_REQUEST_NULL, MPI_REQUEST_NULL, MPI_REQUEST_NULL };
+  double const* func = NULL;
+  double scale = 0;
+  double residuum;
+  double maxresiduum = 0;
+
+  /* the nodes above and to the left need our first line and column for their first iteration */
+  MPI_Isend(&GRID(Matrix, 1, 1), lM, MPI_DOUBLE, mpis.up, 1, mpis.comm, &sends[2]);
+  MPI_Isend(&GRID(Matrix, 1, 1), 1, mpis.column, mpis.left, 2, mpis.comm, &sends[3]);
+
+  for (t = 0; t < iterations; t++)
+  {
+    /* waiting here is the fill and drain of the pipeline */
+    TRACE_BEGIN(0, "halo");
+    MPI_Recv(&GRID(Matrix, 0, 1), lM, MPI_DOUBLE, mpis.up, 1, mpis.comm, MPI_STATUS_IGNORE);
+    MPI_Recv(&GRID(Matrix, 1, 0), 1, mpis.column, mpis.left, 2, mpis.comm, MPI_STATUS_IGNORE);
+    MPI_Recv(&GRID(Matrix, lN + 1, 1), lM, MPI_DOUBLE, mpis.down, 1, mpis.comm, MPI_STATUS_IGNORE);
+    MPI_Recv(&GRID(Matrix, 1, lM + 1), 1, mpis.column, mpis.right, 2, mpis.comm, MPI_STATUS_IGNORE);
+
+    /* the lines of the last iteration must be sent before they change */
+    MPI_Waitall(4, sends, MPI_STATUSES_IGNORE);
+    TRACE_END(0);
+
+    TRACE_BEGIN(0, "sweep");
+    maxresiduum = 0;
+
+    for (i = 1; i <= lN; i++)
+    {
+      if (options->inf_func == FUNC_FPISIN)
+      {
+        func = GRID_LINE(&arguments->Func, (arguments->Func.rows > 1) ? i : 0);
+        scale = GRID(&arguments->FuncScale, 0, i);
+      }
+
+      residuum = gaussSeidelLine(GRID_LINE(Matrix, i), GRID_LINE(Matrix, i - 1), GRID_LINE(Matrix, i + 1),
+                                 func, scale, lM + 1, 1, 1);
+      maxresiduum = (residuum < maxresiduum) ? maxresiduum : residuum;
+    }
+    TRACE_END(0);
+
+    /* last line and column for iteration t of the nodes below and to the right, */
+    /* first line and column for iteration t+1 of the nodes above and to the left */
+    MPI_Isend(&GRID(Matrix, lN, 1), lM, MPI_DOUBLE, mpis.down, 1, mpis.comm, &sends[0]);
+    MPI_Isend(&GRID(Matrix, 1, lM), 1, mpis.column, mpis.right, 2, mpis.comm, &sends[1]);
+
+    if (t + 1 < iterations)
+    {
+      MPI_Isend(&GRID(Matrix, 1, 1), lM, MPI_DOUBLE, mpis.up, 1, mpis.comm, &sends[2]);
+      MPI_Isend(&GRID(Matrix, 1, 1), 1, mpis.column, mpis.left, 2, mpis.comm, &sends[3]);
+    }
+
+    if (NULL != residuals)
+    {
+      residuals[t] = maxresiduum;
+    }
+  }
+
+  MPI_Waitall(4, sends, MPI_STATUSES_IGNORE);
+
+  return maxresiduum;
+}
+
+/* ************************************************************************ */
+/* calculateGaussSeidel: solves the equation with the pipelined Gauss-      */
+/* Seidel method. With TERM_PREC the residuals are only known after the    */
+/* pipeline has drained, so they are compared in chunks of iterations. The  */
+/* own lines are saved before each chunk; if the precision was reached     */
+/* before the end of the chunk, they are restored and exactly the           */
+/* iterations of the sequential program are repeated.                       */
+/* Checkpoints are written between two runs of the pipeline, when no       */
+/* iteration is in flight.                                                  */
+/* ************************************************************************ */
+static
+void
+calculateGaussSeidel (struct calculation_arguments* arguments, struct calculation_results *results, struct options* options)
+{
+  int t, n;
+  int chunk = PIPELINE_CHUNK * (mpis.dims[0] + mpis.dims[1] - 2);
+  size_t own = (size_t)mpis.localN * arguments->Matrix[0].stride * sizeof(double);
+  double residuum;
+  double* residuals;
+
+  results->m = 0;
+
+  if (options->termination == TERM_ITER)
+  {
+    residuum = 0;
+
+    while (options->term_iteration > 0)
+    {
+      /* up to the next checkpoint */
+      n = options->term_iteration;
+      if (NULL != ckpt.file && n > ckpt.interval - results->stat_iteration % ckpt.interval)
+      {
+        n = ckpt.interval - results->stat_iteration % ckpt.interval;
+      }
+
+      residuum = pipelineGaussSeidel(arguments, options, n, NULL);
+      results->stat_iteration += n;
+      options->term_iteration -= n;
+
+      if (options->term_iteration > 0)
+      {
+        writeCheckpoint(arguments, results, options, 0);
+      }
+    }
+
+    MPI_Allreduce(MPI_IN_PLACE, &residuum, 1, MPI_DOUBLE, MPI_MAX, mpis.comm);
+    results->stat_precision = residuum;
+    return;
+  }
+
+  /* a single node knows the residuum after every iteration */
+  chunk = (chunk < 1) ? 1 : chunk;
+  residuals = allocateMemory(chunk * sizeof(double));
+
+  while (options->term_iteration > 0)
+  {
+    n = chunk;
+
+    if (n > 1)
+    {
+      memcpy(GRID_LINE(&arguments->Matrix[1], 1), GRID_LINE(&arguments->Matrix[0], 1), own);
+    }
+
+    pipelineGaussSeidel(arguments, options, n, residuals);
+    TRACE_BEGIN(0, "allreduce");
+    MPI_Allreduce(MPI_IN_PLACE, residuals, n, MPI_DOUBLE, MPI_MAX, mpis.comm);
+    TRACE_END(0);
+
+    for (t = 0; t < n && residuals[t] >= options->term_precision; t++)
+    {
+      /* first iteration of the chunk that reached the precision */
+    }
+
+    if (t < n)
+    {
+      /* the sequential program stops after iteration t+1 of this chunk */
+      if (t + 1 < n)
+      {
+        memcpy(GRID_LINE(&arguments->Matrix[0], 1), GRID_LINE(&arguments->Matrix[1], 1), own);
+        pipelineGaussSeidel(arguments, options, t + 1, NULL);
+      }
+
+      n = t + 1;
+      options->term_iteration = 0;
+    }
+
+    results->stat_iteration += n;
+    results->stat_precision = residuals[n - 1];
+
+    if (options->term_iteration > 0 && checkpointDue(results, n))
+    {
+      writeCheckpoint(arguments, results, options, 0);
+    }
+  }
+
+  free(residuals);
+}
+
+/* ************************************************************************ */
+/* initHaloGrid: creates persistent requests for the ghostline exchange of  */
+/* grid m: receive lines 0 and lN+1 and columns 0 and lM+1, send lines 1    */
+/* and lN and columns 1 and lM (at the border of the matrix the neighbour   */
+/* is MPI_PROC_NULL)                                                        */
+/* ************************************************************************ */
+static
+void
+initHaloGrid (struct grid* m, MPI_Request halo[8])
+{
+  int lN = mpis.localN;
+  int lM = mpis.localM;
+
+  MPI_Recv_init(&GRID(m, 0, 1), lM, MPI_DOUBLE, mpis.up, 1, mpis.comm, &halo[0]);
+  MPI_Recv_init(&GRID(m, lN + 1, 1), lM, MPI_DOUBLE, mpis.down, 1, mpis.comm, &halo[1]);
+  MPI_Recv_init(&GRID(m, 1, 0), 1, mpis.column, mpis.left, 2, mpis.comm, &halo[2]);
+  MPI_Recv_init(&GRID(m, 1, lM + 1), 1, mpis.column, mpis.right, 2, mpis.comm, &halo[3]);
+  MPI_Send_init(&GRID(m, 1, 1), lM, MPI_DOUBLE, mpis.up, 1, mpis.comm, &halo[4]);
+  MPI_Send_init(&GRID(m, lN, 1), lM, MPI_DOUBLE, mpis.down, 1, mpis.comm, &halo[5]);
+  MPI_Send_init(&GRID(m, 1, 1), 1, mpis.column, mpis.left, 2, mpis.comm, &halo[6]);
+  MPI_Send_init(&GRID(m, 1, lM), 1, mpis.column, mpis.right, 2, mpis.comm, &halo[7]);
+}
+
+/* ************************************************************************ */
+/* initHalo: persistent ghostline requests of every matrix (initHaloGrid)   */
+/* ************************************************************************ */
+static
+void
+initHalo (struct calculation_arguments* arguments, MPI_Request halo[2][8])
+{
+  int g;
+
+  for (g = 0; g < arguments->num_matrices; g++)
+  {
+    initHaloGrid(&arguments->Matrix[g], halo[g]);
+  }
+}
+
+/* ************************************************************************ */
+/* freeHalo: frees the persistent requests of initHalo                      */
+/* ************************************************************************ */
+static
+void
+freeHalo (struct calculation_arguments* arguments, MPI_Request halo[2][8])
+{
+  int g, r;
+
+  for (g = 0; g < arguments->num_matrices; g++)
+  {
+    for (r = 0; r < 8; r++)
+    {
+      MPI_Request_free(&halo[g][r]);
+    }
+  }
+}
+
+/* ************************************************************************ */
+/* calculatePoints: calculates the points jfirst..jlast of own line i of    */
+/* Matrix[m1] from Matrix[m2] (Jacobi) or the points of one color in place  */
+/* (red-black, SOR), returns their maximum residuum                         */
+/* ************************************************************************ */
+static
+double
+calculatePoints (struct calculation_arguments* arguments, struct options* options, int m1, int m2,
+                 int i, int jfirst, int jlast, int color)
+{
+  int gi = mpis.first - 1 + i;                /* global index of line i                         */
+  int o = jfirst - 1;                         /* offset for the line kernel                     */
+  struct grid* Matrix = arguments->Matrix;
+  double const* func = NULL;                  /* forcing term of line i and its line factor     */
+  double scale = 0;
+
+  if (options->inf_func == FUNC_FPISIN)
+  {
+    func = GRID_LINE(&arguments->Func, (arguments->Func.rows > 1) ? i : 0);
+    scale = GRID(&arguments->FuncScale, 0, i);
+  }
+
+  if (options->method == METH_JACOBI)
+  {
+    /* vectorized line kernel (stencil.c) */
+    return jacobiLine(GRID_LINE(&Matrix[m1], i) + o, GRID_LINE(&Matrix[m2], i - 1) + o, GRID_LINE(&Matrix[m2], i) + o,
+                      GRID_LINE(&Matrix[m2], i + 1) + o, (NULL != func) ? func + o : NULL, scale, jlast - jfirst + 2);
+  }
+
+  if (options->method == METH_SOR)
+  {
+    /* red-black as below, over-relaxed by omega */
+    return sorLine(GRID_LINE(&Matrix[m1], i), GRID_LINE(&Matrix[m2], i - 1), GRID_LINE(&Matrix[m2], i + 1),
+                   func, scale, arguments->omega, jlast + 1, jfirst + (gi + mpis.firstcol - 1 + jfirst + color) % 2, 2);
+  }
+
+  /* red-black: only the points with (global i + global j) % 2 == color */
+  return gaussSeidelLine(GRID_LINE(&Matrix[m1], i), GRID_LINE(&Matrix[m2], i - 1), GRID_LINE(&Matrix[m2], i + 1),
+                         func, scale, jlast + 1, jfirst + (gi + mpis.firstcol - 1 + jfirst + color) % 2, 2);
+}
+
+/* ************************************************************************ */
+/* applyLaplace: q = Ap on the points jfirst..jlast of own line i, A is 4p  */
+/* minus the four neighbours; the halos of p are zero at the border         */
+/* ************************************************************************ */
+static
+void
+applyLaplace (struct grid* q, struct grid* p, int i, int jfirst, int jlast)
+{
+  int j;
+  double* out = GRID_LINE(q, i);
+  double const* up = GRID_LINE(p, i - 1);
+  double const* mid = GRID_LINE(p, i);
+  double const* down = GRID_LINE(p, i + 1);
+
+  for (j = jfirst; j <= jlast; j++)
+  {
+    out[j] = 4 * mid[j] - (up[j] + mid[j - 1] + mid[j + 1] + down[j]);
+  }
+}
+
+/* ************************************************************************ */
+/* calculateCG: solves the equation with the pipelined conjugate gradient   */
+/* method (Ghysels and Vanroose): besides r and p the vectors w = Ar,       */
+/* s = Ap, z = As and m = Aw are kept by recurrences, so the two dot        */
+/* products (r,r) and (w,r) of an iteration are independent of its only     */
+/* product with A, m = Aw. Their MPI_Iallreduce runs while the ghostlines   */
+/* of w are exchanged and m is calculated; there is one synchronization     */
+/* point per iteration instead of two.                                      */
+/* The residuum of an iteration is max |r| / 4 = max |star - u|, the one a  */
+/* Jacobi sweep would report; it is reduced together with (r,r), so the     */
+/* termination is decided one product with A later. Checkpoints save the   */
+/* approximation only, a restart begins a new CG iteration there.           */
+/* ************************************************************************ */
+static
+void
+calculateCG (struct calculation_arguments* arguments, struct calculation_results *results, struct options* options)
+{
+  int v, i, j;
+  int lN = mpis.localN;
+  int lM = mpis.localM;
+  int split = (mpis.dims[1] > 1);             /* ghostcolumns: first and last column last       */
+  int first = 1;                              /* no iteration done yet                          */
+  struct grid* U = &arguments->Matrix[0];
+  struct grid Vectors[6];                     /* r, w = Ar, m = Aw, z, s, p                     */
+  struct grid* R = &Vectors[0];
+  struct grid* W = &Vectors[1];
+  struct grid* M = &Vectors[2];
+  struct grid* Z = &Vectors[3];
+  struct grid* S = &Vectors[4];
+  struct grid* P = &Vectors[5];
+  MPI_Request halo[8];                        /* persistent ghostline requests of w             */
+  MPI_Request reductions[2];
+  double local[2] = { 0, 0 };                 /* (r,r) and (w,r), own points and all nodes      */
+  double global[2];
+  double localmax = 0;                        /* max |r|, own points and all nodes              */
+  double globalmax;
+  double const* func = NULL;                  /* forcing term of line i and its line factor     */
+  double scale = 0;
+  double gamma, delta;
+  double gamma_old = 0;
+  double alpha = 0;
+  double beta;
+  double denominator;
+
+  /* all vectors are zero outside the matrix */
+  for (v = 0; v < 6; v++)
+  {
+    allocateGrid(&Vectors[v], lN + 2, lM + 2);
+    memset(Vectors[v].data, 0, (size_t)(lN + 2) * Vectors[v].stride * sizeof(double));
+  }
+
+  /* r = b - Au = 4 (star - u) */
+  for (i = 1; i <= lN; i++)
+  {
+    if (options->inf_func == FUNC_FPISIN)
+    {
+      func = GRID_LINE(&arguments->Func, (arguments->Func.rows > 1) ? i : 0);
+      scale = GRID(&arguments->FuncScale, 0, i);
+    }
+
+    jacobiLine(GRID_LINE(R, i), GRID_LINE(U, i - 1), GRID_LINE(U, i), GRID_LINE(U, i + 1), func, scale, lM + 1);
+
+    for (j = 1; j <= lM; j++)
+    {
+      GRID(R, i, j) = 4 * (GRID(R, i, j) - GRID(U, i, j));
+    }
+  }
+
+  /* w = Ar */
+  exchangeGhostlines(R);
+
+  for (i = 1; i <= lN; i++)
+  {
+    applyLaplace(W, R, i, 1, lM);
+
+    for (j = 1; j <= lM; j++)
+    {
+      local[0] += GRID(R, i, j) * GRID(R, i, j);
+      local[1] += GRID(W, i, j) * GRID(R, i, j);
+      localmax = (fabs(GRID(R, i, j)) < localmax) ? localmax : fabs(GRID(R, i, j));
+    }
+  }
+
+  if (!mpis.blocking)
+  {
+    initHaloGrid(W, halo);
+  }
+
+  while (options->term_iteration > 0)
+  {
+    MPI_Iallreduce(local, global, 2, MPI_DOUBLE, MPI_SUM, mpis.comm, &reductions[0]);
+    MPI_Iallreduce(&localmax, &globalmax, 1, MPI_DOUBLE, MPI_MAX, mpis.comm, &reductions[1]);
+
+    /* m = Aw while the dot products are reduced */
+    if (mpis.blocking)
+    {
+      TRACE_BEGIN(0, "halo");
+      exchangeGhostlines(W);
+      TRACE_END(0);
+
+      for (i = 1; i <= lN; i++)
+      {
+        applyLaplace(M, W, i, 1, lM);
+      }
+    }
+    else
+    {
+      MPI_Startall(8, halo);
+
+      /* the inner points do not need the ghostlines */
+      for (i = 2; i < lN; i++)
+      {
+        applyLaplace(M, W, i, 1 + split, lM - split);
+      }
+
+      TRACE_BEGIN(0, "halo");
+      MPI_Waitall(8, halo, MPI_STATUSES_IGNORE);
+      TRACE_END(0);
+
+      applyLaplace(M, W, 1, 1, lM);
+
+      if (lN > 1)
+      {
+        applyLaplace(M, W, lN, 1, lM);
+      }
+
+      for (i = 2; split && i < lN; i++)
+      {
+        applyLaplace(M, W, i, 1, 1);
+
+        if (lM > 1)
+        {
+          applyLaplace(M, W, i, lM, lM);
+        }
+      }
+    }
+
+    TRACE_BEGIN(0, "allreduce");
+    MPI_Waitall(2, reductions, MPI_STATUSES_IGNORE);
+    TRACE_END(0);
+
+    /* check for stopping calculation with the residual of the last iteration */
+    if (!first)
     {
-      arguments->Matrix[i] = allocateMemory((N + 1) * sizeof(double*)); /* element wise acess through pointers */
-      for (j = 0; j <= N; j++)
+      results->stat_precision = globalmax * 0.25;
+
+      if (options->termination == TERM_PREC && results->stat_precision < options->term_precision)
       {
-	arguments->Matrix[i][j] = (double*)(arguments->M + (i * (N + 1) * (N + 1)) + (j * (N + 1)));
+        options->term_iteration = 0;
+        continue;
       }
     }
-  }else
-  /* allocate memory on the nodes. */
-  {
-    arguments->M = allocateMemory(arguments->num_matrices * (mpis.localN + 1) * (N + 1) * sizeof(double));
-    arguments->Matrix = allocateMemory(arguments->num_matrices * sizeof(double**));
-    /* Debug
-    printf("Prozess%i hat %i Zeilen allokiert und eine weitere Zeile belegt.\n", mpis.rank, (N / mpis.worldsize));
-    * Debug */
-    for (i = 0; i < arguments->num_matrices; i++)
+
+    gamma = global[0];
+    delta = global[1];
+
+    if (first)
+    {
+      beta = 0;
+      alpha = (delta > 0) ? gamma / delta : 0;
+    }
+    else
+    {
+      beta = (gamma_old > 0) ? gamma / gamma_old : 0;
+      denominator = (alpha > 0) ? delta - beta * gamma / alpha : 0;
+      alpha = (denominator > 0) ? gamma / denominator : 0;
+    }
+
+    /* z = m + beta z, s = w + beta s, p = r + beta p, */
+    /* u = u + alpha p, r = r - alpha s, w = w - alpha z */
+    TRACE_BEGIN(0, "update");
+    local[0] = 0;
+    local[1] = 0;
+    localmax = 0;
+
+    for (i = 1; i <= lN; i++)
     {
-      arguments->Matrix[i] = allocateMemory((N + 1) * sizeof(double*)); /* element wise acess through pointers */
-      for (j = 0; j <= N; j++)
+      double* u = GRID_LINE(U, i);
+      double* r = GRID_LINE(R, i);
+      double* w = GRID_LINE(W, i);
+      double const* m = GRID_LINE(M, i);
+      double* z = GRID_LINE(Z, i);
+      double* s = GRID_LINE(S, i);
+      double* p = GRID_LINE(P, i);
+
+      for (j = 1; j <= lM; j++)
       {
-	arguments->Matrix[i][j] = (double*)(arguments->M + (i * (mpis.localN + 1) * (N + 1)) + (j * (N + 1)));
+        z[j] = m[j] + beta * z[j];
+        s[j] = w[j] + beta * s[j];
+        p[j] = r[j] + beta * p[j];
+        u[j] += alpha * p[j];
+        r[j] -= alpha * s[j];
+        w[j] -= alpha * z[j];
+
+        local[0] += r[j] * r[j];
+        local[1] += w[j] * r[j];
+        localmax = (fabs(r[j]) < localmax) ? localmax : fabs(r[j]);
       }
     }
-  }
-}
+    TRACE_END(0);
 
-/* ************************************************************************ */
-/* initMatrices: Initialize matrix/matrices and some global variables       */
-/* ************************************************************************ */
-static
-void
-initMatrices (struct calculation_arguments* arguments, struct options* options)
-{
-  int g, i, j;                                /*  local variables for loops   */
-  int N = arguments->N;
-  int lN = mpis.localN;
-  double h = arguments->h;
-  double*** Matrix = arguments->Matrix;
-  
-  /* initialize matrix/matrices with zeros */
-  for (g = 0; g < arguments->num_matrices; g++)
-  {
-    for (i = 0; i <= ((0 == mpis.rank) ? N : lN); i++)
+    gamma_old = gamma;
+    first = 0;
+    results->stat_iteration++;
+
+    if (options->termination == TERM_ITER)
     {
-      for (j = 0; j <= N; j++)
+      options->term_iteration--;
+
+      if (0 == options->term_iteration)
       {
-		  Matrix[g][i][j] = 0;
+        /* the residuum of the last iteration */
+        MPI_Allreduce(&localmax, &globalmax, 1, MPI_DOUBLE, MPI_MAX, mpis.comm);
+        results->stat_precision = globalmax * 0.25;
       }
     }
+
+    if (options->term_iteration > 0 && checkpointDue(results, 1))
+    {
+      writeCheckpoint(arguments, results, options, 0);
+    }
   }
-  
-  /* initialize borders, depending on function (function 2: nothing to do) */
-  if (options->inf_func == FUNC_F0)
+
+  if (!mpis.blocking)
   {
-     /* Quick Debug
-     double test,test1;
-     test = ((0 == mpis.rank) ? N : (mpis.displ[mpis.rank]+lN));
-     test1 = mpis.displ[mpis.rank];
-     printf("rank%i is initializing from %f to %f. Displacement is %i; lN is %i\n",mpis.rank,test1,test,mpis.displ[mpis.rank],lN);
-      Debug */
-    
-    for(i = mpis.displ[mpis.rank]; i <= ((0 == mpis.rank) ? N : (mpis.displ[mpis.rank]+lN)); i++)
+    for (v = 0; v < 8; v++)
     {
-      for (j = 0; j < arguments->num_matrices; j++)
-      {
-		  Matrix[j][(i-mpis.displ[mpis.rank])][0] = 1 - (h * i);
-		  Matrix[j][(i-mpis.displ[mpis.rank])][N] = h * i;
-	  }
-    }
-    // initialize the top and bottom line
-    for(i = 0; i <= N; i++)
-    {
-		for (j = 0; j < arguments->num_matrices; j++)
-		{
-			if (0 == mpis.rank)
-		  {
-			  Matrix[j][0][i] = 1 - (h * i);
-			  Matrix[j][N][i] = h * i;
-		  }
-		  if (mpis.rank == (mpis.worldsize - 1))
-		  {
-			  Matrix[j][lN][i] = h * i;
-		  }
-		}
-	}
-    // set the corners to zero
-    for (j = 0; j < arguments->num_matrices; j++)
-    {
-		if (0 == mpis.rank)
-		{
-			Matrix[j][N][0] = 0;
-			Matrix[j][0][N] = 0;
-		}
-		if (mpis.rank == (mpis.worldsize-1))
-		{
-			Matrix[j][lN][0] = 0;
-		}
+      MPI_Request_free(&halo[v]);
     }
   }
-}
 
+  for (v = 0; v < 6; v++)
+  {
+    freeGrid(&Vectors[v]);
+  }
+
+  results->m = 0;
+}
 
 /* ************************************************************************ */
 /* calculate: solves the equation                                           */
+/* With TERM_PREC all nodes stop after the same iteration as the           */
+/* sequential program: Jacobi reduces the maximum residuum with            */
+/* MPI_Iallreduce while the next iteration is calculated and, if the       */
+/* precision was reached, returns the previous iteration from the other    */
+/* matrix. Red-black and SOR reduce it with MPI_Allreduce after every     */
+/* iteration.                                                               */
+/* A checkpoint waits for the reduction of its iteration first.             */
 /* ************************************************************************ */
 static
 void
 calculate (struct calculation_arguments* arguments, struct calculation_results *results, struct options* options)
 {
-  int i, j;                                   /* local variables for loops  */
+  int i;                                      /* local variables for loops  */
   int m1, m2;                                 /* used as indices for old and new matrices       */
-  double star;                                /* four times center value minus 4 neigh.b values */
+  int color, colors;                          /* half sweeps per iteration (red-black: 2)       */
+  int due = 0;                                /* the residuum of this iteration is reduced      */
   double residuum;                            /* residuum of current iteration                  */
   double maxresiduum;                         /* maximum residuum value of a slave in iteration */
+  double start;
   //double n_maxresiduum = 0;					/* temporal value of maxresiduum on one Node */
-  int N = arguments->N;
   int lN = mpis.localN;
-  double h = arguments->h;
-  double*** Matrix = arguments->Matrix;
+  int lM = mpis.localM;
+  int split = (mpis.dims[1] > 1);             /* ghostcolumns: first and last column first      */
+  MPI_Request halo[2][8];                     /* persistent ghostline requests per matrix       */
+  MPI_Request reduction = MPI_REQUEST_NULL;   /* Jacobi: reduction of the previous iteration    */
+  double localresiduum;                       /* its send and receive buffers                   */
+  double globalresiduum = 0;
 
-  /* initialize m1 and m2 depending on algorithm */
+  /* Gauss-Seidel: iterations handed from node to node */
   if (options->method == METH_GAUSS_SEIDEL)
   {
-    m1=0; m2=0;
+    calculateGaussSeidel(arguments, results, options);
+    return;
+  }
+
+  if (options->method == METH_CG)
+  {
+    calculateCG(arguments, results, options);
+    return;
   }
-  else			/* Jacobi */
+
+  /* initialize m1 and m2 depending on algorithm */
+  if (options->method == METH_JACOBI)
   {
     m1=0; m2=1;
   }
-  
+  else			/* red-black, SOR */
+  {
+    m1=0; m2=0;
+  }
+
+  colors = (options->method == METH_RED_BLACK || options->method == METH_SOR) ? 2 : 1;
+
+  if (!mpis.blocking)
+  {
+    initHalo(arguments, halo);
+  }
+
   while (options->term_iteration > 0)
   {
     maxresiduum = 0;
-    /* over all rows */
-    for (i = 1; i < lN; i++)
+    /* red-black: all red points (global i + j even) first, then all black */
+    /* points, the ghostlines are exchanged after each color               */
+    for (color = 0; color < colors; color++)
     {
-      /* over all columns */
-      for (j = 1; j < N; j++)
+      if (mpis.blocking)
+      {
+        TRACE_BEGIN(0, "sweep");
+        /* over all rows */
+        for (i = 1; i <= lN; i++)
+        {
+          residuum = calculatePoints(arguments, options, m1, m2, i, 1, lM, color);
+          maxresiduum = (residuum < maxresiduum) ? maxresiduum : residuum;
+        }
+        TRACE_END(0);
+
+        // Send the ghostlines to the neigbours
+        TRACE_BEGIN(0, "halo");
+        exchangeGhostlines(&arguments->Matrix[m1]);
+        TRACE_END(0);
+      }
+      else
       {
-	star = (Matrix[m2][i-1][j] + Matrix[m2][i][j-1] + Matrix[m2][i][j+1] + Matrix[m2][i+1][j]) * 0.25;
-	
-	if (options->inf_func == FUNC_FPISIN)
-	{
-	  star = (TWO_PI_SQUARE * sin((double)(j) * PI * h) * sin((double)(i) * PI * h) * h * h * 0.25) + star;
-	}
-	
-	residuum = Matrix[m2][i][j] - star;
-	residuum = (residuum < 0) ? -residuum : residuum;
-	/* temporal calculation of maxresiduum per thread */
-	maxresiduum = (residuum < maxresiduum) ? maxresiduum : residuum;
-	
-	Matrix[m1][i][j] = star;
+        TRACE_BEGIN(0, "sweep");
+        /* first and last own line and column, they are sent while the inner points are calculated */
+        residuum = calculatePoints(arguments, options, m1, m2, 1, 1, lM, color);
+        maxresiduum = (residuum < maxresiduum) ? maxresiduum : residuum;
+
+        if (lN > 1)
+        {
+          residuum = calculatePoints(arguments, options, m1, m2, lN, 1, lM, color);
+          maxresiduum = (residuum < maxresiduum) ? maxresiduum : residuum;
+        }
+
+        for (i = 2; split && i < lN; i++)
+        {
+          residuum = calculatePoints(arguments, options, m1, m2, i, 1, 1, color);
+          maxresiduum = (residuum < maxresiduum) ? maxresiduum : residuum;
+
+          if (lM > 1)
+          {
+            residuum = calculatePoints(arguments, options, m1, m2, i, lM, lM, color);
+            maxresiduum = (residuum < maxresiduum) ? maxresiduum : residuum;
+          }
+        }
+
+        MPI_Startall(8, halo[m1]);
+
+        for (i = 2; i < lN; i++)
+        {
+          residuum = calculatePoints(arguments, options, m1, m2, i, 1 + split, lM - split, color);
+          maxresiduum = (residuum < maxresiduum) ? maxresiduum : residuum;
+        }
+        TRACE_END(0);
+
+        /* the part of the exchange that the inner points did not hide */
+        TRACE_BEGIN(0, "halo");
+        MPI_Waitall(8, halo[m1], MPI_STATUSES_IGNORE);
+        TRACE_END(0);
       }
     }
-    
+
     results->stat_iteration++;
+
+    /* all nodes need the maximum residuum of all nodes */
+    if (options->termination == TERM_PREC && options->method == METH_JACOBI)
+    {
+      /* the reduction of the previous iteration ran during this sweep; */
+      /* its values are still in Matrix[m2]                             */
+      if (MPI_REQUEST_NULL != reduction)
+      {
+        TRACE_BEGIN(0, "allreduce");
+        start = MPI_Wtime();
+        MPI_Wait(&reduction, MPI_STATUS_IGNORE);
+        residual.time += MPI_Wtime() - start;
+        TRACE_END(0);
+        residualUpdate(&residual, results->stat_iteration - 1, globalresiduum, options->term_precision);
+
+        if (globalresiduum < options->term_precision)
+        {
+          /* stop with the previous iteration, like the sequential program */
+          results->stat_iteration--;
+          results->stat_precision = globalresiduum;
+          options->term_iteration = 0;
+          continue;
+        }
+      }
+
+      /* --residual=adaptive: only the planned iterations are reduced */
+      if (residualDue(&residual, results->stat_iteration, options->term_iteration == 1))
+      {
+        localresiduum = maxresiduum;
+        MPI_Iallreduce(&localresiduum, &globalresiduum, 1, MPI_DOUBLE, MPI_MAX, mpis.comm, &reduction);
+      }
+    }
+    else if (options->termination == TERM_PREC || options->term_iteration == 1)
+    {
+      due = residualDue(&residual, results->stat_iteration, options->term_iteration == 1);
+
+      /* red-black works in place and cannot go back: wait for the result */
+      if (due)
+      {
+        TRACE_BEGIN(0, "allreduce");
+        start = MPI_Wtime();
+        MPI_Allreduce(MPI_IN_PLACE, &maxresiduum, 1, MPI_DOUBLE, MPI_MAX, mpis.comm);
+        residual.time += MPI_Wtime() - start;
+        TRACE_END(0);
+        residualUpdate(&residual, results->stat_iteration, maxresiduum, options->term_precision);
+      }
+    }
+
     results->stat_precision = maxresiduum;
     /* exchange m1 and m2 */
     i=m1; m1=m2; m2=i;
-    // Send the ghostlines to the neigbours
-    //(first and last node are treated differently)
-    if(0 == mpis.rank)
-    {
-      MPI_Send(Matrix[m2][lN-1-1],N,MPI_DOUBLE,mpis.rank + 1, 1,MPI_COMM_WORLD);
-      MPI_Recv(Matrix[m2][lN-1],N,MPI_DOUBLE,mpis.rank + 1, 1, MPI_COMM_WORLD,MPI_STATUS_IGNORE);
-    } else
-    if(mpis.rank < (mpis.worldsize-1))
-    {
-      MPI_Send(Matrix[m2][1],N,MPI_DOUBLE,mpis.rank - 1,1,MPI_COMM_WORLD);
-      MPI_Recv(Matrix[m2][0],N,MPI_DOUBLE,mpis.rank - 1, 1, MPI_COMM_WORLD,MPI_STATUS_IGNORE);
-      
-      MPI_Recv(Matrix[m2][lN-1],N,MPI_DOUBLE,mpis.rank + 1, 1, MPI_COMM_WORLD,MPI_STATUS_IGNORE);
-      MPI_Send(Matrix[m2][lN-1-1],N,MPI_DOUBLE,mpis.rank + 1,1,MPI_COMM_WORLD);
-    } else
-    if (mpis.rank == (mpis.worldsize-1))
-    {
-		MPI_Send(Matrix[m2][1],N,MPI_DOUBLE,mpis.rank - 1,1,MPI_COMM_WORLD);
-		MPI_Recv(Matrix[m2][0],N,MPI_DOUBLE,mpis.rank - 1, 1, MPI_COMM_WORLD,MPI_STATUS_IGNORE);
-	}
     /* Jacobi: One Iteration on many nodes.
-     * Gauss-Seidel: Many iterations handed from node to node. */
+     * Gauss-Seidel: Many iterations handed from node to node (calculateGaussSeidel). */
     
     /* check for stopping calculation, depending on termination method */
     if (options->termination == TERM_PREC)
     {
-      if (maxresiduum < options->term_precision) 
+      /* Jacobi: checked one iteration later, see above */
+      if (options->method != METH_JACOBI && due && maxresiduum < options->term_precision)
       {
 		  options->term_iteration = 0;
       }
@@ -355,26 +1324,174 @@ calculate (struct calculation_arguments* arguments, struct calculation_results *
     {
       options->term_iteration--;
     }
+
+    /* periodic checkpoint of the iteration in Matrix[m2] */
+    if (options->term_iteration > 0 && checkpointDue(results, 1))
+    {
+      if (MPI_REQUEST_NULL != reduction)
+      {
+        /* the checkpoint must not depend on a reduction in flight */
+        MPI_Wait(&reduction, MPI_STATUS_IGNORE);
+        residualUpdate(&residual, results->stat_iteration, globalresiduum, options->term_precision);
+        results->stat_precision = globalresiduum;
+
+        if (globalresiduum < options->term_precision)
+        {
+          options->term_iteration = 0;
+          continue;
+        }
+      }
+
+      TRACE_BEGIN(0, "checkpoint");
+      writeCheckpoint(arguments, results, options, m2);
+      TRACE_END(0);
+    }
+  }
+
+  if (!mpis.blocking)
+  {
+    freeHalo(arguments, halo);
+  }
+
+  results->m = m2;
+}
+
+/* ************************************************************************ */
+/* gatherTrace: collects the events of all nodes on the master-node, which  */
+/* writes them into one trace, and switches tracing off. The clocks are    */
+/* only comparable between the processes of one computer.                  */
+/* ************************************************************************ */
+static
+void
+gatherTrace (void)
+{
+  int p;
+  int length;
+  int* lengths = NULL;
+  int* displs = NULL;
+  size_t size;
+  char* events;
+  char* all = NULL;
+
+  if (!trace_on)
+  {
+    return;
+  }
+
+  events = traceEvents(&size);
+  length = (int)size;
+
+  if (0 == mpis.rank)
+  {
+    lengths = allocateMemory(mpis.worldsize * sizeof(int));
+    displs = allocateMemory(mpis.worldsize * sizeof(int));
+  }
+
+  MPI_Gather(&length, 1, MPI_INT, lengths, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+  if (0 == mpis.rank)
+  {
+    size = 0;
+
+    for (p = 0; p < mpis.worldsize; p++)
+    {
+      displs[p] = (int)size;
+      size += lengths[p];
+    }
+
+    all = allocateMemory(size + 1);
   }
-  /* Collecting the results frm the nodes. Nodes have different amounts of
-   * lines to send (see calculation of localN).
-   * Number of lines to send is in counts[], displacement in lines from 0
-   * in displ[]. 
-   * MPI_Gatherv is not recommendable since send and recieve-buffer cant be
-   * the same and all processes (including 0) are sending.*/
-   if (0 != mpis.rank)
+
+  MPI_Gatherv(events, length, MPI_CHAR, all, lengths, displs, MPI_CHAR, 0, MPI_COMM_WORLD);
+
+  if (0 == mpis.rank)
   {
-    MPI_Send(Matrix[m2][1], (lN - mpis.ghostlines) * N, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD);
-  }else
+    traceSave(all, size);
+    free(all);
+    free(lengths);
+    free(displs);
+  }
+
+  free(events);
+  traceFree();
+}
+
+/* ************************************************************************ */
+/* gatherSamples: collects the 9x9 points that DisplayMatrix shows (every   */
+/* interlines+1-th line and column) on the master-node. Every node sets the */
+/* points inside its block (blockOf) and zeros elsewhere; every point       */
+/* belongs to exactly one block, so a sum over all nodes gives the points.  */
+/* No node ever holds more than its own block.                              */
+/* ************************************************************************ */
+static
+void
+gatherSamples (struct calculation_arguments* arguments, struct calculation_results* results, struct options* options)
+{
+  int x, y;
+  int gi, gj;
+  int r0, r1, c0, c1;
+  double samples[9 * 9];
+  struct grid* Matrix = &arguments->Matrix[results->m];
+
+  blockOf(mpis.coords, arguments->N, &r0, &r1, &c0, &c1);
+
+  for (y = 0; y < 9; y++)
   {
-    for (i = 1; i < mpis.worldsize; i++)
+    for (x = 0; x < 9; x++)
     {
-      MPI_Recv(Matrix[m2][(mpis.displ[i] + 1)],(mpis.counts[i] - mpis.glines[i]) * N,
-			MPI_DOUBLE, i,0,MPI_COMM_WORLD,MPI_STATUS_IGNORE);
+      gi = y * (options->interlines + 1);
+      gj = x * (options->interlines + 1);
+      samples[y * 9 + x] = 0;
+
+      if (r0 <= gi && gi <= r1 && c0 <= gj && gj <= c1)
+      {
+        samples[y * 9 + x] = GRID(Matrix, gi - mpis.first + 1, gj - mpis.firstcol + 1);
+      }
     }
   }
-  results->m = m2;
+
+  MPI_Reduce((0 == mpis.rank) ? MPI_IN_PLACE : samples, samples, 9 * 9, MPI_DOUBLE, MPI_SUM, 0, mpis.comm);
+
+  if (0 == mpis.rank)
+  {
+    for (y = 0; y < 9; y++)
+    {
+      for (x = 0; x < 9; x++)
+      {
+        GRID(&arguments->Samples, y, x) = samples[y * 9 + x];
+      }
+    }
+  }
+}
+
+/* ************************************************************************ */
+/* trafficModel: bytes from and to memory per point and iteration for the   */
+/* roofline report, compulsory traffic without write allocate as in         */
+/* benchmark.sh: every pass reads and writes each matrix value once and     */
+/* reads the forcing term table (the separable form stays in the cache).    */
+/* Describes the layout in model; 0: no model for the method                */
+/* ************************************************************************ */
+static
+double
+trafficModel (struct calculation_arguments* arguments, struct options* options, char* model, size_t size)
+{
+  int passes = (options->method == METH_RED_BLACK || options->method == METH_SOR) ? 2 : 1;
+  int table = (options->inf_func == FUNC_FPISIN && arguments->Func.rows > 1);
+  char const* matrix = (options->method == METH_JACOBI) ? "2 Matrizen" : "1 Matrix";
+  double bytes = 16.0 * passes + ((table) ? 8.0 * passes : 0);
+
+  if (options->method == METH_CG)
+  {
+    snprintf(model, size, "keines fuer CG");
+    return 0;
+  }
+
+  snprintf(model, size, "%.1f Byte pro Punkt (%s, Stoerfunktion %s)", bytes, matrix,
+           (options->inf_func == FUNC_F0) ? "keine" : (table) ? "Tabelle" : "separabel");
+
+  return bytes;
 }
+
 /* ************************************************************************ */
 /*  displayStatistics: displays some statistics about the calculation       */
 /* ************************************************************************ */
@@ -388,23 +1505,63 @@ static void displayStatistics (struct calculation_arguments* arguments, struct c
   //Calculate Flops
   // star op = 5 ASM ops (+1 XOR) with -O3, matrix korrektur = 1
   double q = 6;
+  double q_func = 0;
   double mflops;
-  
-  if (options->inf_func == FUNC_F0)
+
+  // residuum: checked 1 flop in ASM, verified on Nehalem architecture.
+  q += 1.0;
+
+  if (options->method == METH_SOR)
   {
-    // residuum: checked 1 flop in ASM, verified on Nehalem architecture.
-    q += 1.0;
+    // over-relaxation: one multiplication with omega and one addition
+    q += 2.0;
   }
-  else
+
+  if (options->inf_func == FUNC_FPISIN)
   {
-    // residuum: 11 with O0, but 10 with "gcc -O3", without counting sin & cos
-    q += 10.0;
+    // forcing term: precomputed, one multiplication with the line factor and one addition
+    q_func = 2.0;
   }
-  
-  /* calculate flops  */
-  mflops = (q * (N - 1) * (N - 1) * results->stat_iteration) * 1e-6;
+
+  /* calculate flops, with and without the forcing term */
+  mflops = ((q + q_func) * (N - 1) * (N - 1) * results->stat_iteration) * 1e-6;
   printf("Executed float ops: %f MFlop\n", mflops);
   printf("Speed:              %f MFlop/s\n", mflops / time);
+  printf("Speed ohne Stoerf.: %f MFlop/s\n", (q * (N - 1) * (N - 1) * results->stat_iteration) * 1e-6 / time);
+
+  if (timeline != NULL)
+  {
+    int p;
+    double first = timeline[0], last = timeline[1];
+    double start = timeline[0], end = timeline[1];
+    double uncertainty = 0;
+
+    /* all processes on the clock of rank 0 */
+    for (p = 0; p < mpis.worldsize; p++)
+    {
+      first = (timeline[3 * p] < first) ? timeline[3 * p] : first;
+      start = (timeline[3 * p] < start) ? start : timeline[3 * p];
+      end = (timeline[3 * p + 1] < end) ? timeline[3 * p + 1] : end;
+      last = (timeline[3 * p + 1] < last) ? last : timeline[3 * p + 1];
+      uncertainty = (timeline[3 * p + 2] < uncertainty) ? uncertainty : timeline[3 * p + 2];
+    }
+
+    printf("Zeit alle Prozesse: %f s, Start %.1f us und Ende %.1f us auseinander (+- %.1f us)\n",
+           last - first, (start - first) * 1e6, (last - end) * 1e6, uncertainty * 1e6);
+  }
+
+  if (counters != NULL)
+  {
+    counterReport(counters, mpis.worldsize, "Prozess", mflops, time);
+  }
+
+  if (roofline != NULL)
+  {
+    char model[160];
+    double bytes = trafficModel(arguments, options, model, sizeof(model));
+
+    rooflineReport(roofline, mpis.worldsize, "Prozesse", mflops, bytes * (N - 1) * (N - 1) * results->stat_iteration * 1e-6, time, model);
+  }
   
   printf("Berechnungsmethode: ");
   
@@ -416,8 +1573,31 @@ static void displayStatistics (struct calculation_arguments* arguments, struct c
   {
     printf("Jacobi");
   }
+  else if (options->method == METH_RED_BLACK)
+  {
+    printf("Gauss-Seidel (Rot-Schwarz)");
+  }
+  else if (options->method == METH_CG)
+  {
+    printf("Konjugierte Gradienten (pipelined)");
+  }
+  else if (options->method == METH_SOR)
+  {
+    printf("SOR (Rot-Schwarz)");
+  }
   
   printf("\n");
+  printf("Rechenkern:         %s\n", stencilName());
+  printf("Randzeilen:         %s\n", mpis.blocking ? "blockierend" : "nicht blockierend, ueberlappt");
+  printf("Zerlegung:          %d x %d Knoten (%s)\n", mpis.dims[0], mpis.dims[1], (1 == mpis.dims[1]) ? "Zeilen" : "Bloecke");
+
+  if (options->method == METH_SOR)
+  {
+    printf("Relaxation:         omega = %f (%s)\n", arguments->omega, (options->omega > 0) ? "--omega" : "2/(1+sin(pi h))");
+  }
+
+  residualReport(&residual, results->stat_iteration);
+
   printf("Interlines:         %d\n",options->interlines);
   printf("Stoerfunktion:      ");
   
@@ -445,55 +1625,68 @@ static void displayStatistics (struct calculation_arguments* arguments, struct c
   printf("\n");
   printf("Anzahl Iterationen: %d\n", results->stat_iteration);
   printf("Norm des Fehlers:   %e\n", results->stat_precision);
+
+  if (NULL != ckpt.restart)
+  {
+    printf("Neustart:           %s nach Iteration %d\n", ckpt.restart, ckpt.header.stat_iteration);
+  }
+
+  if (ckpt.count > 0)
+  {
+    /* the checkpoint time is part of the Berechnungszeit */
+    printf("Checkpoints:        %d x %.1f MB, %.1f MB/s\n", ckpt.count,
+           ckpt.bytes / ckpt.count * 1e-6, ckpt.bytes / ckpt.time * 1e-6);
+    printf("Checkpoint-Zeit:    %f s (%.1f %%), %f ms pro Iteration\n", ckpt.time, 100 * ckpt.time / time,
+           ckpt.time * 1e3 / (results->stat_iteration - ((NULL != ckpt.restart) ? ckpt.header.stat_iteration : 0)));
+  }
 }
 /* ************************************************************************************ */
 /* initMPI: reads and calculates values related to MPI and using it througout the prog. */
 /* ************************************************************************************ */
 static void initMPI(struct mpi_stats* mpis, struct calculation_arguments* arguments)
 {
-  int j = 0;
+  int N = arguments->N;
+  int periods[2] = { 0, 0 };
+  char const* decomp = getenv("PARTDIFF_DECOMP");
+
   MPI_Comm_size(MPI_COMM_WORLD,&mpis->worldsize);
-  MPI_Comm_rank(MPI_COMM_WORLD,&mpis->rank);
-  int ghostlines = ((0 == mpis->rank)||(mpis->rank == (mpis->worldsize -1)) ? 1 : 2);
-  mpis->ghostlines = ghostlines;
-  if (1 == isBignode(mpis->rank,arguments))
-  {
-    mpis->bignode = 1;
-    //1 extra for big node 2 extra for ghostlines
-    mpis->localN = ((arguments->N / mpis->worldsize)+1+ghostlines);
-  }
-  else if (0 == isBignode(mpis->rank,arguments))
-  {
-    mpis->bignode = 0;
-    //2 extra for ghostlines
-    mpis->localN = ((arguments->N / mpis->worldsize)+ghostlines);
-  }
-  mpis->counts = allocateMemory(mpis->worldsize * sizeof(int));
-  mpis->displ = allocateMemory(mpis->worldsize * sizeof(int));
-  mpis->glines = allocateMemory(mpis->worldsize * sizeof(int));
-  int lines_per_node = arguments->N / mpis->worldsize;
-  int number_big_nodes = arguments->N % mpis->worldsize;
-  
-  for (j = 0; j < mpis->worldsize; j++)
+
+  /* PARTDIFF_DECOMP=rows: one column of nodes (lines only), otherwise */
+  /* blocks, the node grid is chosen as square as possible             */
+  mpis->dims[0] = 0;
+  mpis->dims[1] = 0;
+  if (NULL != decomp && 0 == strcmp(decomp, "rows"))
   {
-	  ghostlines = ((0 == j)||(j == (mpis->worldsize -1)) ? 1 : 2);
-	  mpis->glines[j] = ghostlines;
-    if (1 == isBignode(j,arguments))
-    {
-      mpis->counts[j] = ((arguments->N / mpis->worldsize)+ 1 + ghostlines);
-      //(number of nodes so far (j) times the lines per node) plus 1 for every node so far (big nodes)
-      //minus 1 for extra line in calculation
-      mpis->displ[j] = ((j * (arguments->N / mpis->worldsize)) + j) - ((0 == j) ? 0 : 1);
-    }else if (0 == isBignode(j,arguments))
+    mpis->dims[0] = mpis->worldsize;
+    mpis->dims[1] = 1;
+  }
+  MPI_Dims_create(mpis->worldsize, 2, mpis->dims);
+
+  MPI_Cart_create(MPI_COMM_WORLD, 2, mpis->dims, periods, 1, &mpis->comm);
+  MPI_Comm_rank(mpis->comm, &mpis->rank);
+  MPI_Cart_coords(mpis->comm, mpis->rank, 2, mpis->coords);
+  MPI_Cart_shift(mpis->comm, 0, 1, &mpis->up, &mpis->down);
+  MPI_Cart_shift(mpis->comm, 1, 1, &mpis->left, &mpis->right);
+
+  if ((N - 1) < mpis->dims[0] || (N - 1) < mpis->dims[1])
+  {
+    if (0 == mpis->rank)
     {
-      mpis->counts[j] = (arguments->N / mpis->worldsize) + ghostlines;
-      // all bigger nodes + all small nodes so far - 1 (see above)
-      // all bigger nodes = (arguments->N % mpis.worldsize)*(arguments->N + 1)
-      // all small nodes so far = ((j + 1) - (arguments->N % mpis.worldsize))*(arguments->N + 1)
-      mpis->displ[j] = ((((number_big_nodes * lines_per_node) + number_big_nodes)
-      + ((j - number_big_nodes) * lines_per_node)) - ((0 == j) ? 0 : 1));
+      printf("Matrix has only %d inner lines, too small for %d x %d nodes.\n", N - 1, mpis->dims[0], mpis->dims[1]);
     }
+    MPI_Abort(MPI_COMM_WORLD, 1);
   }
+
+  /* the N-1 inner lines and columns are distributed on the node grid */
+  distribute(N - 1, mpis->dims[0], mpis->coords[0], &mpis->first, &mpis->localN);
+  distribute(N - 1, mpis->dims[1], mpis->coords[1], &mpis->firstcol, &mpis->localM);
+
+  /* own part of a column: localN values, one line (stride) apart */
+  MPI_Type_vector(mpis->localN, 1, gridStride(mpis->localM + 2), MPI_DOUBLE, &mpis->column);
+  MPI_Type_commit(&mpis->column);
+
+  /* the blocking ghostline exchange is kept for comparison */
+  mpis->blocking = (NULL != getenv("PARTDIFF_HALO") && 0 == strcmp(getenv("PARTDIFF_HALO"), "blocking"));
   if (mpis->worldsize == 1)
   {
     printf("Given worldsize does not allow for MPI parallelization. Trying OpenMP...?\n");
@@ -518,22 +1711,110 @@ main (int argc, char** argv)
     MPI_Abort(MPI_COMM_WORLD, rc);
   }
   AskParams(&options, argc, argv);                    /* get parameters */   
+  initCheckpoint(&options);                           /* restart: options of the checkpoint */
+  initStencil();                                      /* select line kernel */
   initVariables(&arguments, &results, &options);           /* ******************************************* */
   initMPI(&mpis, &arguments);	                     /* initalize MPI */
   allocateMatrices(&arguments);                            /*  get and initialize variables and matrices  */
   initMatrices(&arguments, &options);                      /* ******************************************* */
+  initFunction(&arguments, &options);                      /*  precompute forcing term                    */
+  if (NULL != ckpt.restart)
+  {
+    readCheckpoint(&arguments, &results);                  /*  continue from the checkpoint               */
+  }
   
+  /* --roofline: all processes probe at the same time */
+  if (options.roofline)
+  {
+    roofline = malloc(((0 == mpis.rank) ? mpis.worldsize : 1) * sizeof(struct roofline));
+    MPI_Barrier(MPI_COMM_WORLD);
+    rooflineProbe(roofline, ROOFLINE_ELEMENTS / mpis.worldsize);
+    MPI_Gather((0 == mpis.rank) ? MPI_IN_PLACE : (void*)roofline, sizeof(struct roofline), MPI_BYTE,
+               roofline, sizeof(struct roofline), MPI_BYTE, 0, MPI_COMM_WORLD);
+  }
+
+  /* hardware counters: rank 0 decides, mpirun need not pass the environment */
+  rc = counterEnabled();
+  MPI_Bcast(&rc, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  if (rc)
+  {
+    counters = malloc(((0 == mpis.rank) ? mpis.worldsize : 1) * sizeof(struct counters));
+  }
+
+  /* tracing: rank 0 decides and writes the file, pid = rank */
+  rc = traceWanted();
+  MPI_Bcast(&rc, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  if (rc)
+  {
+    traceInit(1, mpis.rank);
+  }
+
+  /* clocks: with tracing or PARTDIFF_CLOCKSYNC=1, offsets before the run */
+  rc = (NULL != getenv("PARTDIFF_CLOCKSYNC") && atoi(getenv("PARTDIFF_CLOCKSYNC")) > 0);
+  MPI_Bcast(&rc, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  if (rc || trace_on)
+  {
+    clocks = calloc(1, sizeof(struct clocksync));
+    timeline = malloc(((0 == mpis.rank) ? mpis.worldsize : 1) * 3 * sizeof(double));
+    clockSync(clocks, MPI_COMM_WORLD);
+  }
+
+  residualInit(&residual, options.adaptive, options.termination == TERM_PREC, options.method != METH_SOR);
+
   gettimeofday(&start_time, NULL);                   /*  start timer         */
+  if (timeline != NULL)
+  {
+    timeline[0] = clockNow();
+  }
+  if (counters != NULL)
+  {
+    counterStart(counters);
+  }
   calculate(&arguments, &results, &options);         /*  solve the equation  */
+  if (counters != NULL)
+  {
+    counterStop(counters);
+  }
+  if (timeline != NULL)
+  {
+    timeline[1] = clockNow();
+  }
   gettimeofday(&comp_time, NULL);                    /*  stop timer          */
+  gatherSamples(&arguments, &results, &options);     /*  collect the result  */
+  if (counters != NULL)
+  {
+    /* same program on all nodes: the structures are sent as bytes */
+    MPI_Gather((0 == mpis.rank) ? MPI_IN_PLACE : (void*)counters, sizeof(struct counters), MPI_BYTE,
+               counters, sizeof(struct counters), MPI_BYTE, 0, MPI_COMM_WORLD);
+  }
+  if (clocks != NULL)
+  {
+    /* the second measurement gives the drift during the run */
+    clockSync(clocks, MPI_COMM_WORLD);
+    timeline[2] = clockUncertainty(clocks, timeline[1]);
+    timeline[0] = clockGlobal(clocks, timeline[0]);
+    timeline[1] = clockGlobal(clocks, timeline[1]);
+    MPI_Gather((0 == mpis.rank) ? MPI_IN_PLACE : (void*)timeline, 3, MPI_DOUBLE,
+               timeline, 3, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    traceClock(clocks->offset, clocks->drift, clocks->reference, clockUncertainty(clocks, clocks->last));
+  }
   if (0 == mpis.rank)
   {
     displayStatistics(&arguments, &results, &options);               /* **************** */
     DisplayMatrix("Matrix:",                                         /*  display some    */
-		  arguments.Matrix[results.m][0], options.interlines);       /*  statistics and  */
+		  &arguments.Samples, 0);                                    /*  statistics and  */
+  }
+  if (clocks != NULL)
+  {
+    clockReport(clocks, MPI_COMM_WORLD);
   }
   freeMatrices(&arguments);
   freeMPI(&mpis);                                                      /*  free memory     */
+  free(counters);
+  free(roofline);
+  gatherTrace();
+  free(clocks);
+  free(timeline);
   /* **************** */
   //MPI_Barrier(MPI_COMM_WORLD);
   MPI_Finalize();
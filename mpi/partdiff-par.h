@@ -19,6 +19,7 @@
 #include <stdlib.h>
 #include <time.h>
 #include <malloc.h>
+#include "grid.h"
 
 /* ************* */
 /* Some defines. */
@@ -30,10 +31,18 @@
 #define MAX_ITERATION  		200000
 #define METH_GAUSS_SEIDEL 	1
 #define METH_JACOBI 		2
+#define METH_RED_BLACK		3
+#define METH_CG			5
+#define METH_SOR		6
 #define FUNC_F0			1
 #define FUNC_FPISIN		2
 #define TERM_PREC		1
 #define TERM_ITER		2
+#define FUNC_TABLE_MAX		(256 * 1024)	/* max. bytes of a full forcing term table */
+#define PIPELINE_CHUNK		8		/* Gauss-Seidel, TERM_PREC: iterations per pipeline stage between two checks */
+#define CHECKPOINT_INTERVAL	1000		/* default number of iterations between two checkpoints */
+#define CHECKPOINT_OFFSET	512		/* bytes reserved for the header of a checkpoint file */
+#define CHECKPOINT_MAGIC	"PDIFFCP1"	/* first 8 bytes of a checkpoint file */
 
 struct options
 {
@@ -44,6 +53,9 @@ struct options
 	int     termination;    /* termination condition                          */
 	int     term_iteration; /* terminate if iteration number reached          */
 	double  term_precision; /* terminate if precision reached                 */
+	double  omega;          /* --omega: SOR relaxation factor, 0: automatic   */
+	int     roofline;       /* --roofline: bandwidth and peak probes          */
+	int     adaptive;       /* --residual=adaptive: residuum every few iter.  */
 };
 
 /* *************************** */
@@ -55,6 +67,4 @@ struct options
 /* *************************** */
 void AskParams( struct options*, int, char** );
 
-void DisplayMatrix ( char*, double*, int );
-
-void DisplayMatrixAddr ( char*, double***, int, int );
+void DisplayMatrix ( char*, struct grid*, int );
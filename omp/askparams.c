@@ -40,8 +40,11 @@
 /****************************************************************************/
 /** int *method;                                                           **/
 /**         Bezeichnet das bei der L"osung der Poissongleichung zu         **/
-/**         verwendende Verfahren ( Gauss-Seidel oder Jacobi ).            **/
-/** Werte:  METH_GAUSS_SEIDEL  oder METH_JACOBI (definierte Konstanten)    **/
+/**         verwendende Verfahren ( Gauss-Seidel, Jacobi, Gauss-Seidel in  **/
+/**         Rot-Schwarz-Reihenfolge, Mehrgitterverfahren, konjugierte      **/
+/**         Gradienten oder SOR in Rot-Schwarz-Reihenfolge ).              **/
+/** Werte:  METH_GAUSS_SEIDEL, METH_JACOBI, METH_RED_BLACK,              **/
+/**         METH_MULTIGRID, METH_CG oder METH_SOR                          **/
 /****************************************************************************/
 /** int *interlines:                                                       **/
 /**         Gibt die Zwischenzeilen zwischen den auszugebenden             **/
@@ -71,12 +74,49 @@
 /**         Es wird jeweils nur einer der beiden Parameter f"ur die        **/
 /**         Abbruchbedingung eingelesen.                                   **/
 /****************************************************************************/
+/** char const *affinity:                                                  **/
+/**         Optional, nur auf der Kommandozeile nach den sechs Parametern: **/
+/**         --affinity=compact  Threads Sockel f"ur Sockel auf die Kerne   **/
+/**         --affinity=scatter  Threads reihum auf die Sockel              **/
+/**         --affinity=0,2,4-7  Threads der Reihe nach auf diese Kerne     **/
+/**         Ohne die Option werden die Threads nicht gebunden (NULL).      **/
+/****************************************************************************/
+/** int cycle, smoother:                                                   **/
+/**         Optional, nur f"ur METH_MULTIGRID:                             **/
+/**         --cycle=v|f         V-Zyklus (CYCLE_V, Vorgabe) oder F-Zyklus  **/
+/**         --smoother=gauss-seidel|jacobi|red-black                       **/
+/**                             Gl"atter (METH_*), Vorgabe Rot-Schwarz     **/
+/****************************************************************************/
+/** double omega:                                                          **/
+/**         Optional, nur f"ur METH_SOR:                                   **/
+/**         --omega=<wert>      Relaxationsfaktor, 0 < wert < 2            **/
+/**         Ohne die Option (0) wird der optimale Faktor 2/(1+sin(pi h))   **/
+/**         aus der Maschenweite h berechnet.                              **/
+/****************************************************************************/
+/** int mixed:                                                             **/
+/**         Optional, nur f"ur METH_JACOBI:                                **/
+/**         --precision=mixed   Iterationen in float, Korrekturen und      **/
+/**                             Residuum in double                         **/
+/**         --precision=double  nur double (Vorgabe)                       **/
+/****************************************************************************/
+/** int roofline:                                                         **/
+/**         Optional: --roofline misst vor der Rechnung Speicherbandbreite **/
+/**         und Spitzenleistung mit derselben Threadzahl und Bindung und   **/
+/**         vergleicht die Rechnung in der Statistik damit (Roofline).     **/
+/****************************************************************************/
+/** int adaptive:                                                          **/
+/**         Optional: --residual=adaptive wertet das Residuum nur alle     **/
+/**         paar Iterationen aus, der Abstand folgt aus der beobachteten   **/
+/**         Konvergenz (residual.c); --residual=always jede (Vorgabe).     **/
+/****************************************************************************/
 
 #include "partdiff-seq.h"
 #include <string.h>
 
 void AskParams( struct options* options, int argc, char** argv )
 {
+	int i;
+
 	printf ( "\n");
 	printf ( "============================================================\n"  );
 	printf ( "Program for calculation of partial differential equations.  \n" );
@@ -86,6 +126,14 @@ void AskParams( struct options* options, int argc, char** argv )
 	printf ( "    Andreas C. Schmidt, TU München.\n");
 	printf ( "============================================================\n"  );
 
+	options->affinity = NULL;
+	options->cycle = CYCLE_V;
+	options->smoother = METH_RED_BLACK;
+	options->omega = 0;
+	options->mixed = 0;
+	options->roofline = 0;
+	options->adaptive = 0;
+
 	if( argc < 2 )
 	{
 		/* ----------------------------------------------- */
@@ -107,11 +155,15 @@ void AskParams( struct options* options, int argc, char** argv )
 			printf( "Select calculationmethod:\n");
 			printf( "  %1d: Gauss-Seidel.\n", METH_GAUSS_SEIDEL);
 			printf( "  %1d: Jacobi.\n",       METH_JACOBI);
+			printf( "  %1d: Gauss-Seidel (red-black).\n", METH_RED_BLACK);
+			printf( "  %1d: Multigrid.\n",   METH_MULTIGRID);
+			printf( "  %1d: Conjugate gradients.\n", METH_CG);
+			printf( "  %1d: SOR (red-black).\n", METH_SOR);
 			printf( "method> ");
 			fflush( stdout );
 			ret = scanf("%d", &(options->method));
 		}
-		while ( (options->method < METH_GAUSS_SEIDEL) || (options->method > METH_JACOBI) );
+		while ( (options->method < METH_GAUSS_SEIDEL) || (options->method > METH_SOR) );
 		do
 		{
 			printf ( "\n" );
@@ -182,10 +234,14 @@ void AskParams( struct options* options, int argc, char** argv )
 		    argc < 7)
 		{
 			printf("\nUsage:\n");
-			printf("partdiff [num] [method] [lines] [func] [term] [prec/iter]\n");
+			printf("partdiff [num] [method] [lines] [func] [term] [prec/iter] [options]\n");
 			printf("  - num:    number of threads to use\n");
 			printf("  - method: %1d: Gauss-Seidel.\n", METH_GAUSS_SEIDEL);
 			printf("            %1d: Jacobi.\n",       METH_JACOBI);
+			printf("            %1d: Gauss-Seidel (red-black).\n", METH_RED_BLACK);
+			printf("            %1d: Multigrid.\n",   METH_MULTIGRID);
+			printf("            %1d: Conjugate gradients.\n", METH_CG);
+			printf("            %1d: SOR (red-black).\n", METH_SOR);
 			printf("  - lines:  (lines=interlines) matrixsize = interlines*8+9\n");
 			printf("  - func:   %1d: f(x,y)=0.\n",                        FUNC_F0);
 			printf("            %1d: f(x,y)=2pi^2*sin(pi*x)sin(pi*y).\n", FUNC_FPISIN);
@@ -194,6 +250,14 @@ void AskParams( struct options* options, int argc, char** argv )
 			printf("  - prec/iter: depending on term:\n");
 			printf("            precision:  Range: 1e-4 .. 1e-20.\n");
 			printf("            iterations: Range: 1 .. %d.\n", MAX_ITERATION );
+			printf("  - options:\n");
+			printf("            --affinity=compact|scatter|<core list>: bind the threads\n");
+			printf("            --cycle=v|f: multigrid cycle\n");
+			printf("            --smoother=gauss-seidel|jacobi|red-black: multigrid smoother\n");
+			printf("            --omega=<value>: SOR relaxation factor, default 2/(1+sin(pi h))\n");
+			printf("            --precision=mixed|double: Jacobi sweeps in float, refinement in double\n");
+			printf("            --roofline: measure bandwidth and peak, compare the solver with them\n");
+			printf("            --residual=adaptive|always: evaluate the residuum only every few iterations\n");
 			printf("\n");
 			printf("Example: %s 1 2 100 1 2 100 \n", argv[0]);
 			exit(0);
@@ -215,5 +279,62 @@ void AskParams( struct options* options, int argc, char** argv )
 			sscanf( argv[6],"%d", &(options->term_iteration));
 			options->term_precision = 0;
 		}
+
+		/* optional parameters: --name=value */
+		for (i = 7; i < argc; i++)
+		{
+			if (strncmp(argv[i], "--affinity=", 11) == 0)
+			{
+				options->affinity = argv[i] + 11;
+			}
+			else if (strcmp(argv[i], "--cycle=v") == 0 || strcmp(argv[i], "--cycle=f") == 0)
+			{
+				options->cycle = (argv[i][8] == 'v') ? CYCLE_V : CYCLE_F;
+			}
+			else if (strcmp(argv[i], "--smoother=gauss-seidel") == 0)
+			{
+				options->smoother = METH_GAUSS_SEIDEL;
+			}
+			else if (strcmp(argv[i], "--smoother=jacobi") == 0)
+			{
+				options->smoother = METH_JACOBI;
+			}
+			else if (strcmp(argv[i], "--smoother=red-black") == 0)
+			{
+				options->smoother = METH_RED_BLACK;
+			}
+			else if (strncmp(argv[i], "--omega=", 8) == 0)
+			{
+				if (sscanf(argv[i] + 8, "%lf", &(options->omega)) != 1 ||
+				    options->omega <= 0 || options->omega >= 2)
+				{
+					printf("SOR needs 0 < omega < 2: %s\n", argv[i]);
+					exit(1);
+				}
+			}
+			else if (strcmp(argv[i], "--precision=mixed") == 0 || strcmp(argv[i], "--precision=double") == 0)
+			{
+				options->mixed = (argv[i][12] == 'm');
+			}
+			else if (strcmp(argv[i], "--roofline") == 0)
+			{
+				options->roofline = 1;
+			}
+			else if (strcmp(argv[i], "--residual=adaptive") == 0 || strcmp(argv[i], "--residual=always") == 0)
+			{
+				options->adaptive = (strcmp(argv[i], "--residual=adaptive") == 0);
+			}
+			else
+			{
+				printf("Unknown option %s\n", argv[i]);
+				exit(1);
+			}
+		}
+
+		if (options->mixed && options->method != METH_JACOBI)
+		{
+			printf("--precision=mixed needs method %d (Jacobi)\n", METH_JACOBI);
+			exit(1);
+		}
 	}
 }
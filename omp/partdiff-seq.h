@@ -19,6 +19,7 @@
 #include <stdlib.h>
 #include <time.h>
 #include <malloc.h>
+#include "grid.h"
 
 /* ************* */
 /* Some defines. */
@@ -30,10 +31,31 @@
 #define MAX_ITERATION  		200000
 #define METH_GAUSS_SEIDEL 	1
 #define METH_JACOBI 		2
+#define METH_RED_BLACK		3
+#define METH_MULTIGRID		4
+#define METH_CG			5
+#define METH_SOR		6
+#define CYCLE_V			1
+#define CYCLE_F			2
 #define FUNC_F0			1
 #define FUNC_FPISIN		2
 #define TERM_PREC		1
 #define TERM_ITER		2
+#define FUNC_TABLE_MAX		(256 * 1024)	/* max. bytes of a full forcing term table */
+#define TEMPORAL_DEPTH		8		/* Jacobi, PARTDIFF_TEMPORAL: default iterations per wavefront */
+#define TEMPORAL_MAX		64		/* max. iterations per wavefront */
+#define TEMPORAL_CACHE		(1024 * 1024)	/* bytes of cache for the lines of one wavefront */
+#define MAX_SOCKETS		16		/* sockets in the bandwidth report */
+#define BANDWIDTH_PASSES	3		/* passes over the matrix to measure the bandwidth */
+#define BARRIER_SPIN		1000		/* pthreads: spins at a barrier before sched_yield */
+#define GS_TILE			256		/* OpenMP Gauss-Seidel: max. lines and columns per tile */
+#define GS_CHUNK		32		/* OpenMP Gauss-Seidel: iterations per task graph */
+#define MG_COARSEST		8		/* multigrid: max. spaces between lines of the coarsest grid */
+#define MG_SWEEPS		2		/* multigrid: smoothing sweeps before and after the coarse grid */
+#define MG_COARSE_SWEEPS	64		/* multigrid: Gauss-Seidel sweeps on the coarsest grid */
+#define MG_OMEGA		0.8		/* multigrid: damping of the Jacobi smoother */
+#define MIXED_REDUCTION		1e-3		/* mixed precision: float reduces the residuum by this factor per correction */
+#define MIXED_STALL		1000		/* mixed precision: float iterations without a new minimum before a correction */
 
 struct options
 {
@@ -44,6 +66,13 @@ struct options
 	int     termination;    /* termination condition                          */
 	int     term_iteration; /* terminate if iteration number reached          */
 	double  term_precision; /* terminate if precision reached                 */
+	char const* affinity;   /* --affinity: compact, scatter, core list or NULL */
+	int     cycle;          /* --cycle: multigrid V- or F-cycle               */
+	int     smoother;       /* --smoother: multigrid smoother (METH_*)        */
+	double  omega;          /* --omega: SOR relaxation factor, 0: automatic   */
+	int     mixed;          /* --precision=mixed: Jacobi starts in float      */
+	int     roofline;       /* --roofline: bandwidth and peak probes          */
+	int     adaptive;       /* --residual=adaptive: residuum every few iter.  */
 };
 
 /* *************************** */
@@ -55,6 +84,4 @@ struct options
 /* *************************** */
 void AskParams( struct options*, int, char** );
 
-void DisplayMatrix ( char*, double*, int );
-
-void DisplayMatrixAddr ( char*, double***, int, int );
+void DisplayMatrix ( char*, struct grid*, int );
@@ -18,22 +18,45 @@
 /* ************************************************************************ */
 /* Include standard header file.                                            */
 /* ************************************************************************ */
+#define _GNU_SOURCE                             /* sched_setaffinity, sched_getcpu */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <malloc.h>
+#include <sched.h>
 #include <sys/time.h>
 #include "partdiff-seq.h"
+#include "stencil.h"
+#include "counters.h"
+#include "roofline.h"
+#include "trace.h"
+#include "residual.h"
 #include <omp.h>
 
 
+struct level
+{
+	int     N;              /* number of spaces between lines                 */
+	struct grid U;          /* approximation (finest grid) or correction      */
+	struct grid V;          /* Jacobi smoother: new values; residual          */
+	struct grid B;          /* right hand side (finest grid: Func)            */
+};
+
 struct calculation_arguments
 {
 	int     N;              /* number of spaces between lines (lines=N+1)     */
 	int     num_matrices;   /* number of matrices                             */
-	double  ***Matrix;      /* index matrix used for addressing M             */
-	double  *M;             /* two matrices with real values                  */
+	struct grid Matrix[4];  /* matrices with real values (Jacobi: 2 or 3, CG: 4) */
+	struct grid Func;       /* forcing term without line factor (initFunction) */
+	struct grid FuncScale;  /* line factors of the forcing term               */
 	double  h;              /* length of a space between two lines            */
+	double  omega;          /* SOR: relaxation factor                         */
+	int     temporal;       /* Jacobi: iterations per wavefront, 0: sweeps    */
+	int     width;          /* columns per band of a wavefront                */
+	int     levels;         /* multigrid: number of grids                     */
+	struct level* Level;    /* multigrid: grids from fine to coarse           */
+	int     tile;           /* Gauss-Seidel: lines and columns per tile       */
 };
 
 struct calculation_results
@@ -41,6 +64,10 @@ struct calculation_results
 	int     m;
 	int     stat_iteration; /* number of current iteration                    */
 	double  stat_precision; /* actual precision of all slaves in iteration    */
+	double  stat_overhead;  /* seconds per thread waiting at barriers         */
+	int     stat_float_iteration; /* mixed precision: iterations in float     */
+	int     stat_refinements; /* mixed precision: residuals in double         */
+	double  stat_float_time; /* mixed precision: seconds in float            */
 };
 
 /* ************************************************************************ */
@@ -51,6 +78,15 @@ struct calculation_results
 struct timeval start_time;       /* time when program started                      */
 struct timeval comp_time;        /* time when calculation completed                */
 
+/* hardware counters around calculate(), one per thread, NULL if not wanted (PARTDIFF_COUNTERS) */
+struct counters* counters = NULL;
+
+/* bandwidth and peak probes, one per thread, NULL without --roofline */
+struct roofline* roofline = NULL;
+
+/* evaluations of the residuum (--residual=adaptive) */
+struct residual residual;
+
 
 /* ************************************************************************ */
 /* initVariables: Initializes some global variables                         */
@@ -59,13 +95,78 @@ static
 void
 initVariables (struct calculation_arguments* arguments, struct calculation_results* results, struct options* options)
 {
+	char const* temporal = getenv("PARTDIFF_TEMPORAL");
+	char* end;
+	int n;
+
 	arguments->N = options->interlines * 8 + 9 - 1;
-	arguments->num_matrices = (options->method == METH_JACOBI) ? 2 : 1;
+	arguments->num_matrices = (options->method == METH_JACOBI || options->method == METH_MULTIGRID) ? 2 : 1;
 	arguments->h = (float)( ( (float)(1) ) / (arguments->N));
 
+	/* SOR: --omega or the optimal factor of the model problem, 2/(1+sin(pi h)) */
+	arguments->omega = (options->omega > 0) ? options->omega : 2.0 / (1.0 + sin(PI * arguments->h));
+
+	/* Jacobi with temporal blocking: PARTDIFF_TEMPORAL=<iterations per wavefront> */
+	arguments->temporal = 0;
+	if (options->method == METH_JACOBI && NULL != temporal)
+	{
+		arguments->temporal = (int)strtol(temporal, &end, 10);
+		arguments->temporal = (end == temporal) ? TEMPORAL_DEPTH : arguments->temporal;
+		arguments->temporal = (arguments->temporal > TEMPORAL_MAX) ? TEMPORAL_MAX : arguments->temporal;
+		arguments->temporal = (arguments->temporal < 0) ? 0 : arguments->temporal;
+	}
+
+	/* the lines of all iterations of a wavefront in one band fit into the cache */
+	arguments->width = TEMPORAL_CACHE / ((4 * arguments->temporal + 6) * (int)sizeof(double));
+	arguments->width = (arguments->width < 8) ? 8 : arguments->width - arguments->width % 8;
+
+	/* TERM_PREC keeps the start of a wavefront in a third matrix */
+	if (arguments->temporal > 0 && options->termination == TERM_PREC)
+	{
+		arguments->num_matrices = 3;
+	}
+
+	/* Gauss-Seidel: about two tiles per thread of the team in each direction */
+	if (options->method == METH_GAUSS_SEIDEL)
+	{
+		int threads = (omp_get_max_threads() < 1) ? 1 : omp_get_max_threads();
+
+		arguments->tile = (arguments->N - 1 + 2 * threads - 1) / (2 * threads);
+		arguments->tile = (arguments->tile < 8) ? 8 : arguments->tile;
+		arguments->tile = (arguments->tile > GS_TILE) ? GS_TILE : arguments->tile;
+	}
+
+	/* Gauss-Seidel with TERM_PREC keeps the start of a task graph in a second matrix */
+	if (options->method == METH_GAUSS_SEIDEL && options->termination == TERM_PREC)
+	{
+		arguments->num_matrices = 2;
+	}
+
+	/* multigrid: halve the spaces down to MG_COARSEST (rounded up if odd) */
+	arguments->levels = 0;
+	if (options->method == METH_MULTIGRID)
+	{
+		for (n = arguments->N, arguments->levels = 1; n > MG_COARSEST; n = (n + 1) / 2)
+		{
+			arguments->levels++;
+		}
+	}
+
+	/* CG: approximation, residual, direction and its product with A */
+	if (options->method == METH_CG)
+	{
+		arguments->num_matrices = 4;
+	}
+
+	arguments->Func.data = NULL;
+
 	results->m = 0;
 	results->stat_iteration = 0;
 	results->stat_precision = 0;
+	results->stat_float_iteration = 0;
+	results->stat_refinements = 0;
+	results->stat_float_time = 0;
+	results->stat_overhead = 0;
 }
 
 /* ************************************************************************ */
@@ -79,31 +180,27 @@ freeMatrices (struct calculation_arguments* arguments)
 
 	for (i = 0; i < arguments->num_matrices; i++)
 	{
-		free(arguments->Matrix[i]);
+		freeGrid(&arguments->Matrix[i]);
 	}
 
-	free(arguments->Matrix);
-	free(arguments->M);
-}
-
-/* ************************************************************************ */
-/* allocateMemory ()                                                        */
-/* allocates memory and quits if there was a memory allocation problem      */
-/* ************************************************************************ */
-static
-void*
-allocateMemory (size_t size)
-{
-	void *p;
+	if (NULL != arguments->Func.data)
+	{
+		freeGrid(&arguments->Func);
+		freeGrid(&arguments->FuncScale);
+	}
 
-	if ((p = malloc(size)) == NULL)
+	/* the finest grid is Matrix[0] and Matrix[1] */
+	for (i = 1; i < arguments->levels; i++)
 	{
-		printf("\n\nSpeicherprobleme!\n");
-		/* exit program */
-		exit(1);
+		freeGrid(&arguments->Level[i].U);
+		freeGrid(&arguments->Level[i].V);
+		freeGrid(&arguments->Level[i].B);
 	}
 
-	return p;
+	if (arguments->levels > 0)
+	{
+		free(arguments->Level);
+	}
 }
 
 /* ************************************************************************ */
@@ -113,26 +210,46 @@ static
 void
 allocateMatrices (struct calculation_arguments* arguments)
 {
-	int i, j;
+	int i;
 
 	int N = arguments->N;
 
-	arguments->M = allocateMemory(arguments->num_matrices * (N + 1) * (N + 1) * sizeof(double)); 
-	arguments->Matrix = allocateMemory(arguments->num_matrices * sizeof(double**));
-
 	for (i = 0; i < arguments->num_matrices; i++)
 	{
-		arguments->Matrix[i] = allocateMemory((N + 1) * sizeof(double*)); /* Elementzugriff über Zeiger */
+		allocateGrid(&arguments->Matrix[i], N + 1, N + 1); /* Elementzugriff über Zeilenabstand */
+	}
 
-		for (j = 0; j <= N; j++)
+	if (arguments->levels > 0)
+	{
+		arguments->Level = malloc(arguments->levels * sizeof(struct level));
+
+		if (NULL == arguments->Level)
+		{
+			printf("\n\nSpeicherprobleme!\n");
+			/* exit program */
+			exit(1);
+		}
+
+		arguments->Level[0].N = N;
+		arguments->Level[0].U = arguments->Matrix[0];
+		arguments->Level[0].V = arguments->Matrix[1];
+		arguments->Level[0].B.data = NULL;
+
+		for (i = 1; i < arguments->levels; i++)
 		{
-			arguments->Matrix[i][j] = (double*)(arguments->M + (i * (N + 1) * (N + 1)) + (j * (N + 1)));
+			N = arguments->Level[i].N = (arguments->Level[i - 1].N + 1) / 2;
+			allocateGrid(&arguments->Level[i].U, N + 1, N + 1);
+			allocateGrid(&arguments->Level[i].V, N + 1, N + 1);
+			allocateGrid(&arguments->Level[i].B, N + 1, N + 1);
 		}
 	}
 }
 
 /* ************************************************************************ */
 /* initMatrices: Initialize matrix/matrices and some global variables       */
+/* The inner lines are zeroed by the thread that calculates them later      */
+/* (same static schedule over i = 1..N-1 as calculate), so on a NUMA        */
+/* machine their pages are placed on the socket of that thread.             */
 /* ************************************************************************ */
 static
 void
@@ -142,18 +259,25 @@ initMatrices (struct calculation_arguments* arguments, struct options* options)
 
 	int N = arguments->N;
 	double h = arguments->h;
-	double*** Matrix = arguments->Matrix;
+	struct grid* Matrix = arguments->Matrix;
 
-	/* initialize matrix/matrices with zeros */
+	/* initialize matrix/matrices with zeros, first touch by the calculating thread */
 	for (g = 0; g < arguments->num_matrices; g++)
 	{
-		for (i = 0; i <= N; i++)
+		#pragma omp parallel for private(j) schedule(static)
+		for (i = 1; i < N; i++)
 		{
 			for (j = 0; j <= N; j++)
 			{
-				Matrix[g][i][j] = 0;
+				GRID(&Matrix[g], i, j) = 0;
 			}
 		}
+
+		for (j = 0; j <= N; j++)
+		{
+			GRID(&Matrix[g], 0, j) = 0;
+			GRID(&Matrix[g], N, j) = 0;
+		}
 	}
 
 	/* initialize borders, depending on function (function 2: nothing to do) */
@@ -163,218 +287,1649 @@ initMatrices (struct calculation_arguments* arguments, struct options* options)
 		{
 			for (j = 0; j < arguments->num_matrices; j++)
 			{
-				Matrix[j][i][0] = 1 - (h * i);
-				Matrix[j][i][N] = h * i;
-				Matrix[j][0][i] = 1 - (h * i);
-				Matrix[j][N][i] = h * i;
+				GRID(&Matrix[j], i, 0) = 1 - (h * i);
+				GRID(&Matrix[j], i, N) = h * i;
+				GRID(&Matrix[j], 0, i) = 1 - (h * i);
+				GRID(&Matrix[j], N, i) = h * i;
 			}
 		}
 
 		for (j = 0; j < arguments->num_matrices; j++)
 		{
-			Matrix[j][N][0] = 0;
-			Matrix[j][0][N] = 0;
+			GRID(&Matrix[j], N, 0) = 0;
+			GRID(&Matrix[j], 0, N) = 0;
 		}
 	}
 }
 
 
 /* ************************************************************************ */
-/* calculate: solves the equation                                           */
+/* socketOf: socket (physical package) of a processor, 0 if unknown         */
 /* ************************************************************************ */
 static
-void
-calculate (struct calculation_arguments* arguments, struct calculation_results *results, struct options* options)
+int
+socketOf (int cpu)
 {
-	int i, j;                                   /* local variables for loops  */
-	int m1, m2;                                 /* used as indices for old and new matrices       */
-	double star;                                /* four times center value minus 4 neigh.b values */
-	double residuum;                            /* residuum of current iteration                  */
-	double maxresiduum;                         /* maximum residuum value of a slave in iteration */
-	double t_maxresiduum = 0;					/* temporal value of maxresiduum on OpenMp Thread */
-	int N = arguments->N;
-	double h = arguments->h;
-	double*** Matrix = arguments->Matrix;
-	
-	omp_set_num_threads(options->number); /* setting number of openMP Threads */
-	
-	/* Print the number of available processors on the system and the
-	 * maximum number of threads useable */
-	printf("Anzahl Threads: %d\n", omp_get_max_threads());
-	printf("Anzahl Prozessoren: %d\n", omp_get_num_procs());
-
-	/* initialize m1 and m2 depending on algorithm */
-	if (options->method == METH_GAUSS_SEIDEL)
+	char path[128];
+	int socket = 0;
+	FILE* f;
+
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+
+	if ((f = fopen(path, "r")) != NULL)
 	{
-		m1=0; m2=0;
+		if (fscanf(f, "%d", &socket) != 1)
+		{
+			socket = 0;
+		}
+		fclose(f);
 	}
-	else
+
+	return (socket < 0) ? 0 : socket % MAX_SOCKETS;
+}
+
+/* ************************************************************************ */
+/* pinThreads: binds thread k of the team to processor cpus[k % n]          */
+/* (option --affinity). The processors come from the affinity mask of the   */
+/* process:                                                                 */
+/*   compact   socket by socket, neighbouring threads share a socket        */
+/*   scatter   round robin over the sockets                                 */
+/*   list      e.g. 0,2,4-7, in this order                                  */
+/* OpenMP keeps its threads for the following parallel regions, so they    */
+/* stay where they are for the initialization and the calculation.          */
+/* ************************************************************************ */
+static
+void
+pinThreads (struct options* options)
+{
+	int c, k, r, s;
+	int n = 0;                                  /* number of processors to use    */
+	int cpus[CPU_SETSIZE];                      /* processors in the order of use */
+	int rank[CPU_SETSIZE];                      /* scatter: index within socket   */
+	int count[MAX_SOCKETS] = { 0 };
+	char const* a = options->affinity;
+	char* end;
+	cpu_set_t allowed;
+
+	if (NULL == a)
 	{
-		m1=0; m2=1;
+		return;
 	}
 
-	while (options->term_iteration > 0)
+	if (strcmp(a, "compact") == 0 || strcmp(a, "scatter") == 0)
 	{
-		maxresiduum = 0;
-	    /* start parallel part of the program */
-	    /* variables are declared either private, firstprivate, lastprivate or shared */
-	    /* default clause sets this for all variables not mentioned !!!!!*/    
-        #pragma omp parallel for private(residuum, star) firstprivate(j, t_maxresiduum) default(shared)
-		//shared(maxresiduum, N, m2, m1, options, Matrix)
-		/* over all rows */
-		for (i = 1; i < N; i++)
+		sched_getaffinity(0, sizeof(allowed), &allowed);
+
+		for (s = 0; s < MAX_SOCKETS; s++)
 		{
-			/* over all columns */
-			for (j = 1; j < N; j++)
+			for (c = 0; c < CPU_SETSIZE; c++)
 			{
-				star = (Matrix[m2][i-1][j] + Matrix[m2][i][j-1] + Matrix[m2][i][j+1] + Matrix[m2][i+1][j]) * 0.25;
-		
-				if (options->inf_func == FUNC_FPISIN)
+				if (CPU_ISSET(c, &allowed) && socketOf(c) == s)
 				{
-				  star = (TWO_PI_SQUARE * sin((double)(j) * PI * h) * sin((double)(i) * PI * h) * h * h * 0.25) + star;
+					rank[n] = count[s]++;
+					cpus[n++] = c;
 				}
-		
-				residuum = Matrix[m2][i][j] - star;
-				residuum = (residuum < 0) ? -residuum : residuum; /* Durch abs ersetzen (weil Prozessor befehle) */	
-				/* temporal calculation of maxresiduum per thread */
-				t_maxresiduum = (residuum < t_maxresiduum) ? t_maxresiduum : residuum;
-				
-				Matrix[m1][i][j] = star;
 			}
-			/* collect all temporal values of maxresiduum (critical needed to prevent race condition) */
-			#pragma omp critical
+		}
+
+		if (strcmp(a, "scatter") == 0)
+		{
+			/* first processor of every socket, then the second one, ... */
+			int compact[CPU_SETSIZE];
+			int m = 0;
+
+			memcpy(compact, cpus, n * sizeof(int));
+			for (r = 0; m < n; r++)
 			{
-			  maxresiduum = (t_maxresiduum < maxresiduum) ? maxresiduum : t_maxresiduum;
+				for (k = 0; k < n; k++)
+				{
+					if (rank[k] == r)
+					{
+						cpus[m++] = compact[k];
+					}
+				}
 			}
 		}
-		results->stat_iteration++;
-		results->stat_precision = maxresiduum;
+	}
+	else
+	{
+		/* core list: numbers and ranges separated by commas */
+		while (*a != '\0' && n < CPU_SETSIZE)
+		{
+			c = (int)strtol(a, &end, 10);
+			r = c;
 
-		/* exchange m1 and m2 */
-		i=m1; m1=m2; m2=i;
-		/* *********************************************************************** */
-		/* !! !! !! !! !! !! !! !! !! !! !! !! !! !! !! !! !! !! !! !! !! !! !! !! */
-		/* Es kann also nur jeweils eine Iteration überhaupt parallelisiert werden */
-		/* !! !! !! !! !! !! !! !! !! !! !! !! !! !! !! !! !! !! !! !! !! !! !! !! */
-		/* *********************************************************************** */
+			if (end == a || c < 0)
+			{
+				n = 0;
+				break;
+			}
+			if (*end == '-')
+			{
+				a = end + 1;
+				r = (int)strtol(a, &end, 10);
+			}
+			for (; c <= r && c < CPU_SETSIZE && n < CPU_SETSIZE; c++)
+			{
+				cpus[n++] = c;
+			}
 
-		/* check for stopping calculation, depending on termination method */
-		if (options->termination == TERM_PREC)
-		{
-			if (maxresiduum < options->term_precision) 
+			a = (*end == ',') ? end + 1 : end;
+			if (*end != ',' && *end != '\0')
 			{
-				options->term_iteration = 0;
+				n = 0;
+				break;
 			}
 		}
-		else if (options->termination == TERM_ITER)
+	}
+
+	if (0 == n)
+	{
+		printf("Ungueltige Angabe --affinity=%s\n", options->affinity);
+		exit(1);
+	}
+
+	#pragma omp parallel
+	{
+		cpu_set_t set;
+
+		CPU_ZERO(&set);
+		CPU_SET(cpus[omp_get_thread_num() % n], &set);
+
+		if (sched_setaffinity(0, sizeof(set), &set) != 0)
 		{
-			options->term_iteration--;
+			printf("Thread %d kann nicht an Prozessor %d gebunden werden.\n", omp_get_thread_num(), cpus[omp_get_thread_num() % n]);
 		}
 	}
-
-	results->m = m2;
 }
+
 /* ************************************************************************ */
-/*  displayStatistics: displays some statistics about the calculation       */
+/* measureBandwidth: every thread reads its lines of Matrix[0] (the lines   */
+/* it touched first, see initMatrices) BANDWIDTH_PASSES times; prints the   */
+/* read bandwidth per socket. Small matrices are read from the caches.      */
 /* ************************************************************************ */
 static
 void
-displayStatistics (struct calculation_arguments* arguments, struct calculation_results *results, struct options* options)
+measureBandwidth (struct calculation_arguments* arguments)
 {
+	int s;
 	int N = arguments->N;
+	int threads[MAX_SOCKETS] = { 0 };
+	double bytes[MAX_SOCKETS] = { 0 };
+	double seconds[MAX_SOCKETS] = { 0 };
+	double sum = 0;
 
-	double time = (comp_time.tv_sec - start_time.tv_sec) + (comp_time.tv_usec - start_time.tv_usec) * 1e-6;
-	printf("Berechnungszeit:    %f s \n", time);
+	#pragma omp parallel reduction(+:sum)
+	{
+		int i, j, r;
+		int socket = socketOf(sched_getcpu());
+		double part[4] = { 0, 0, 0, 0 };
+		double read = 0;
+		double start = omp_get_wtime();
+		double time;
 
-	//Calculate Flops
-	// star op = 5 ASM ops (+1 XOR) with -O3, matrix korrektur = 1
-	double q = 6;
-	double mflops;
+		for (r = 0; r < BANDWIDTH_PASSES; r++)
+		{
+			#pragma omp for schedule(static) nowait
+			for (i = 1; i < N; i++)
+			{
+				double const* line = GRID_LINE(&arguments->Matrix[0], i);
 
-	if (options->inf_func == FUNC_F0)
+				for (j = 0; j + 3 <= N; j += 4)
+				{
+					part[0] += line[j];
+					part[1] += line[j + 1];
+					part[2] += line[j + 2];
+					part[3] += line[j + 3];
+				}
+				read += (double)j * sizeof(double);     /* line[0..j-1] */
+			}
+		}
+
+		time = omp_get_wtime() - start;
+		sum += part[0] + part[1] + part[2] + part[3];
+
+		#pragma omp critical
+		{
+			threads[socket]++;
+			bytes[socket] += read;
+			seconds[socket] = (time < seconds[socket]) ? seconds[socket] : time;
+		}
+	}
+
+	for (s = 0; s < MAX_SOCKETS; s++)
 	{
-		// residuum: checked 1 flop in ASM, verified on Nehalem architecture.
-		q += 1.0;
+		if (threads[s] > 0)
+		{
+			printf("Lesebandbreite Sockel %d: %.2f GB/s (%d Threads)\n", s, bytes[s] / seconds[s] * 1e-9, threads[s]);
+		}
 	}
-	else
+
+	/* the sum is only calculated so that the reads are not optimized away */
+	if (sum != sum)
 	{
-		// residuum: 11 with O0, but 10 with "gcc -O3", without counting sin & cos
-		q += 10.0;
+		printf("Matrix enthaelt NaN.\n");
 	}
+}
 
-	/* calculate flops  */
-	mflops = (q * (N - 1) * (N - 1) * results->stat_iteration) * 1e-6;
-	printf("Executed float ops: %f MFlop\n", mflops);
-	printf("Speed:              %f MFlop/s\n", mflops / time);
+/* ************************************************************************ */
+/* initFunction: precomputes the forcing term of FUNC_FPISIN                */
+/* The forcing term of point (i,j) is                                       */
+/*     Func(i,j) * FuncScale(i)     table, for small grids                  */
+/*     Func(0,j) * FuncScale(i)     separable, for large grids              */
+/* so calculate() no longer calls sin() for every point and iteration. The  */
+/* table reproduces the former per-point expression exactly; the separable  */
+/* form needs only two vectors but may differ in the last bit.              */
+/* ************************************************************************ */
+static
+void
+initFunction (struct calculation_arguments* arguments, struct options* options)
+{
+	int i, j;
 
-	printf("Berechnungsmethode: ");
+	int N = arguments->N;
+	double h = arguments->h;
+	struct grid* Func = &arguments->Func;
+	double* scale;
 
-	if (options->method == METH_GAUSS_SEIDEL)
+	if (options->inf_func != FUNC_FPISIN)
 	{
-		printf("Gauss-Seidel");
+		return;
 	}
-	else if (options->method == METH_JACOBI)
+
+	allocateGrid(&arguments->FuncScale, 1, N + 1);
+	scale = GRID_LINE(&arguments->FuncScale, 0);
+
+	if ((size_t)(N + 1) * gridStride(N + 1) * sizeof(double) <= FUNC_TABLE_MAX)
 	{
-		printf("Jacobi");
-	}
+		allocateGrid(Func, N + 1, N + 1);
 
-	printf("\n");
-	printf("Interlines:         %d\n",options->interlines);
-	printf("Stoerfunktion:      ");
+		for (i = 0; i <= N; i++)
+		{
+			scale[i] = 1.0;
 
-	if (options->inf_func == FUNC_F0)
+			for (j = 0; j <= N; j++)
+			{
+				GRID(Func, i, j) = TWO_PI_SQUARE * sin((double)(j) * PI * h) * sin((double)(i) * PI * h) * h * h * 0.25;
+			}
+		}
+	}
+	else
 	{
-		printf("f(x,y)=0");
+		allocateGrid(Func, 1, N + 1);
+
+		for (i = 0; i <= N; i++)
+		{
+			scale[i] = sin((double)(i) * PI * h);
+			GRID(Func, 0, i) = TWO_PI_SQUARE * sin((double)(i) * PI * h) * h * h * 0.25;
+		}
 	}
-	else if (options->inf_func == FUNC_FPISIN)
+}
+
+/* ************************************************************************ */
+/* jacobiPoints: calculates the points jfirst..jlast of line i of           */
+/* Matrix[m1] from Matrix[m2], returns their maximum residuum               */
+/* ************************************************************************ */
+static
+double
+jacobiPoints (struct calculation_arguments* arguments, struct options* options, int m1, int m2,
+              int i, int jfirst, int jlast)
+{
+	int o = jfirst - 1;                         /* offset for the line kernel                     */
+	struct grid* Matrix = arguments->Matrix;
+	double const* func = NULL;                  /* forcing term of line i and its line factor     */
+	double scale = 0;
+
+	if (options->inf_func == FUNC_FPISIN)
 	{
-		printf("f(x,y)=2pi^2*sin(pi*x)sin(pi*y)");
+		func = GRID_LINE(&arguments->Func, (arguments->Func.rows > 1) ? i : 0) + o;
+		scale = GRID(&arguments->FuncScale, 0, i);
 	}
 
-	printf("\n");
-	printf("Terminierung:       ");
+	return jacobiLine(GRID_LINE(&Matrix[m1], i) + o, GRID_LINE(&Matrix[m2], i - 1) + o, GRID_LINE(&Matrix[m2], i) + o,
+	                  GRID_LINE(&Matrix[m2], i + 1) + o, func, scale, jlast - jfirst + 2);
+}
 
-	if (options->termination == TERM_PREC)
+/* ************************************************************************ */
+/* jacobiWavefront: performs "depth" Jacobi iterations starting from        */
+/* Matrix[src] with temporal blocking. Iteration t writes Matrix[a] if t   */
+/* is even and Matrix[b] if t is odd; src may be b.                         */
+/* The columns are cut into bands of "width" columns. In every band the     */
+/* iterations run as a wavefront over the lines: in step s iteration t      */
+/* calculates line s - 2t, shifted left by t columns. So iteration t-1 has  */
+/* finished lines i-1..i+1 before iteration t calculates line i, and line i */
+/* of iteration t-2 (same matrix) is no longer needed when it is            */
+/* overwritten. All lines of a band stay in the cache for all "depth"       */
+/* iterations instead of being loaded from memory once per iteration.       */
+/* The iterations of one step work on different lines and run in         */
+/* parallel, one thread per iteration.                                      */
+/* The results are exactly those of "depth" single sweeps. The maximum     */
+/* residuum of every iteration is stored in residuals, the matrix with the  */
+/* last iteration is returned.                                              */
+/* ************************************************************************ */
+static
+int
+jacobiWavefront (struct calculation_arguments* arguments, struct options* options,
+                 int src, int a, int b, int depth, double* residuals)
+{
+	int c0, s, t, i;                            /* first column of the band, step, iteration, line */
+	int N = arguments->N;
+	int width = arguments->width;
+	double residuum;
+
+	for (t = 0; t < depth; t++)
 	{
-		printf("Hinreichende Genaugkeit");
+		residuals[t] = 0;
 	}
-	else if (options->termination == TERM_ITER)
+
+	#pragma omp parallel private(c0, s, t, i, residuum) default(shared)
 	{
-		printf("Anzahl der Iterationen");
+		TRACE_BEGIN(omp_get_thread_num(), "wavefront");
+
+		for (c0 = 1; c0 < N + depth - 1; c0 += width)
+		{
+			for (s = 1; s < N + 2 * (depth - 1); s++)
+			{
+				/* the iterations of one step are independent, one thread each */
+				#pragma omp for schedule(static)
+				for (t = 0; t < depth; t++)
+				{
+					i = s - 2 * t;
+
+					if (1 <= i && i < N)
+					{
+						residuum = jacobiPoints(arguments, options, (t % 2 == 0) ? a : b,
+						                        (t == 0) ? src : ((t % 2 == 1) ? a : b), i,
+						                        (c0 - t < 1) ? 1 : c0 - t, (c0 + width - 1 - t > N - 1) ? N - 1 : c0 + width - 1 - t);
+						residuals[t] = (residuum < residuals[t]) ? residuals[t] : residuum;
+					}
+				}
+			}
+		}
+
+		TRACE_END(omp_get_thread_num());
 	}
 
-	printf("\n");
-	printf("Anzahl Iterationen: %d\n", results->stat_iteration);
-	printf("Norm des Fehlers:   %e\n", results->stat_precision);
+	return ((depth - 1) % 2 == 0) ? a : b;
 }
 
 /* ************************************************************************ */
-/*  main                                                                    */
+/* calculateTemporal: solves the equation with the Jacobi method and        */
+/* temporal blocking (jacobiWavefront), arguments->temporal iterations at a */
+/* time. With TERM_PREC the wavefront starts from a matrix it does not      */
+/* change; if the precision was reached before its last iteration, the      */
+/* iterations up to the first one below the precision are repeated, so      */
+/* stat_iteration and stat_precision are those of the sweeps.               */
 /* ************************************************************************ */
-int
-main (int argc, char** argv)
+static
+void
+calculateTemporal (struct calculation_arguments* arguments, struct calculation_results *results, struct options* options)
 {
-	struct options options;
-	struct calculation_arguments arguments;
-	struct calculation_results results; 
+	int t, n;
+	int src = 0;                                /* matrix with the current iteration              */
+	int last;                                   /* matrix with the last iteration of a wavefront  */
+	double residuals[TEMPORAL_MAX];             /* maximum residuum of every iteration            */
 
-	/* get parameters */
-	AskParams(&options, argc, argv);              /* ************************* */
+	while (options->term_iteration > 0)
+	{
+		n = arguments->temporal;
 
-	initVariables(&arguments, &results, &options);           /* ******************************************* */
+		if (options->termination == TERM_ITER && n > options->term_iteration)
+		{
+			n = options->term_iteration;
+		}
 
-	allocateMatrices(&arguments);        /*  get and initialize variables and matrices  */
-	initMatrices(&arguments, &options);            /* ******************************************* */
+		/* TERM_PREC: the two other matrices, TERM_ITER: the other one and src */
+		last = jacobiWavefront(arguments, options, src, (src + 1) % arguments->num_matrices,
+		                       (src + 2) % arguments->num_matrices, n, residuals);
+
+		if (options->termination == TERM_PREC)
+		{
+			for (t = 0; t < n && residuals[t] >= options->term_precision; t++)
+			{
+				/* first iteration below the precision */
+			}
+
+			if (t < n)
+			{
+				if (t + 1 < n)
+				{
+					last = jacobiWavefront(arguments, options, src, (src + 1) % 3, (src + 2) % 3, t + 1, residuals);
+				}
+
+				n = t + 1;
+				options->term_iteration = 0;
+			}
+		}
+		else if (options->termination == TERM_ITER)
+		{
+			options->term_iteration -= n;
+		}
+
+		results->stat_iteration += n;
+		results->stat_precision = residuals[n - 1];
+		src = last;
+	}
+
+	results->m = src;
+}
+
+/* ************************************************************************ */
+/* gaussSeidelTile: one Gauss-Seidel iteration in place on lines r0..r1,    */
+/* columns c0..c1 of Matrix[0], returns the maximum residuum of the tile    */
+/* ************************************************************************ */
+static
+double
+gaussSeidelTile (struct calculation_arguments* arguments, struct options* options, int r0, int r1, int c0, int c1)
+{
+	int i;
+	struct grid* Matrix = &arguments->Matrix[0];
+	double const* func = NULL;
+	double scale = 0;
+	double residuum;
+	double maxresiduum = 0;
+
+	for (i = r0; i <= r1; i++)
+	{
+		if (options->inf_func == FUNC_FPISIN)
+		{
+			func = GRID_LINE(&arguments->Func, (arguments->Func.rows > 1) ? i : 0);
+			scale = GRID(&arguments->FuncScale, 0, i);
+		}
+
+		residuum = gaussSeidelLine(GRID_LINE(Matrix, i), GRID_LINE(Matrix, i - 1), GRID_LINE(Matrix, i + 1),
+		                           func, scale, c1 + 1, c0, 1);
+		maxresiduum = (residuum < maxresiduum) ? maxresiduum : residuum;
+	}
+
+	return maxresiduum;
+}
+
+/* ************************************************************************ */
+/* gaussSeidelTiles: performs "depth" Gauss-Seidel iterations on Matrix[0]  */
+/* with the results of the sequential program.                              */
+/* The inner points are cut into tiles x tiles square tiles. Iteration t of */
+/* tile (I,J) is one OpenMP task. In the lexicographic order it needs the   */
+/* tiles above and left of it in iteration t and the tiles below and right  */
+/* of it in iteration t-1, and it must not overwrite the tile before those  */
+/* neighbours have read it. Every task reads (in) its four neighbours and   */
+/* writes (inout) its own tile; since the tasks are created in sequential   */
+/* order, these dependencies give exactly the order above. Tiles on a       */
+/* diagonal and later iterations on the upper left tiles run at the same    */
+/* time. The maximum residuum of every iteration is stored in residuals.    */
+/* ************************************************************************ */
+static
+void
+gaussSeidelTiles (struct calculation_arguments* arguments, struct options* options, int depth, double* residuals)
+{
+	int t, I, J, k;
+	int N = arguments->N;
+	int edge = arguments->tile;
+	int tiles = (N - 1 + edge - 1) / edge;      /* tiles per direction                            */
+	char* deps;                                 /* one dependency object per tile and a border    */
+	double* tile_residuals;                     /* maximum residuum per iteration and tile        */
+
+	deps = calloc((size_t)(tiles + 2) * (tiles + 2), sizeof(char));
+	tile_residuals = malloc((size_t)depth * tiles * tiles * sizeof(double));
+
+	if (NULL == deps || NULL == tile_residuals)
+	{
+		printf("\n\nSpeicherprobleme!\n");
+		/* exit program */
+		exit(1);
+	}
+
+	#pragma omp parallel default(shared) private(t, I, J)
+	#pragma omp single
+	for (t = 0; t < depth; t++)
+	{
+		for (I = 0; I < tiles; I++)
+		{
+			for (J = 0; J < tiles; J++)
+			{
+				#pragma omp task firstprivate(t, I, J) \
+				                 depend(in: deps[I * (tiles + 2) + J + 1], deps[(I + 1) * (tiles + 2) + J], \
+				                            deps[(I + 2) * (tiles + 2) + J + 1], deps[(I + 1) * (tiles + 2) + J + 2]) \
+				                 depend(inout: deps[(I + 1) * (tiles + 2) + J + 1])
+				{
+					TRACE_BEGIN(omp_get_thread_num(), "tile");
+					tile_residuals[(t * tiles + I) * tiles + J] =
+						gaussSeidelTile(arguments, options, 1 + I * edge, ((I + 1) * edge < N - 1) ? (I + 1) * edge : N - 1,
+						                1 + J * edge, ((J + 1) * edge < N - 1) ? (J + 1) * edge : N - 1);
+					TRACE_END(omp_get_thread_num());
+				}
+			}
+		}
+	}
+
+	for (t = 0; t < depth; t++)
+	{
+		residuals[t] = 0;
+
+		for (k = 0; k < tiles * tiles; k++)
+		{
+			residuals[t] = (tile_residuals[t * tiles * tiles + k] < residuals[t]) ? residuals[t] : tile_residuals[t * tiles * tiles + k];
+		}
+	}
+
+	free(tile_residuals);
+	free(deps);
+}
+
+/* ************************************************************************ */
+/* calculateGaussSeidel: solves the equation with the Gauss-Seidel method,  */
+/* GS_CHUNK iterations per task graph (gaussSeidelTiles). With TERM_PREC    */
+/* the start of every task graph is copied to Matrix[1]; if the precision   */
+/* was reached before its last iteration, the copy is restored and the      */
+/* iterations up to the first one below the precision are repeated.         */
+/* ************************************************************************ */
+static
+void
+calculateGaussSeidel (struct calculation_arguments* arguments, struct calculation_results *results, struct options* options)
+{
+	int t, n;
+	struct grid* Matrix = arguments->Matrix;
+	size_t bytes = (size_t)Matrix[0].rows * Matrix[0].stride * sizeof(double);
+	double residuals[GS_CHUNK];                 /* maximum residuum of every iteration            */
+
+	while (options->term_iteration > 0)
+	{
+		n = GS_CHUNK;
+
+		if (options->termination == TERM_ITER && n > options->term_iteration)
+		{
+			n = options->term_iteration;
+		}
+
+		if (options->termination == TERM_PREC)
+		{
+			memcpy(Matrix[1].data, Matrix[0].data, bytes);
+		}
+
+		gaussSeidelTiles(arguments, options, n, residuals);
+
+		if (options->termination == TERM_PREC)
+		{
+			for (t = 0; t < n && residuals[t] >= options->term_precision; t++)
+			{
+				/* first iteration below the precision */
+			}
+
+			if (t < n)
+			{
+				if (t + 1 < n)
+				{
+					memcpy(Matrix[0].data, Matrix[1].data, bytes);
+					gaussSeidelTiles(arguments, options, t + 1, residuals);
+				}
+
+				n = t + 1;
+				options->term_iteration = 0;
+			}
+		}
+		else if (options->termination == TERM_ITER)
+		{
+			options->term_iteration -= n;
+		}
+
+		results->stat_iteration += n;
+		results->stat_precision = residuals[n - 1];
+	}
+
+	results->m = 0;
+}
+
+/* ************************************************************************ */
+/* levelFunc: right hand side of line i of grid l for the line kernels:     */
+/* the forcing term on the finest grid, the restricted residual below      */
+/* ************************************************************************ */
+static
+double const*
+levelFunc (struct calculation_arguments* arguments, struct options* options, int l, int i, double* scale)
+{
+	if (l > 0)
+	{
+		*scale = 0.25;
+		return GRID_LINE(&arguments->Level[l].B, i);
+	}
+
+	*scale = 0;
+
+	if (options->inf_func == FUNC_FPISIN)
+	{
+		*scale = GRID(&arguments->FuncScale, 0, i);
+		return GRID_LINE(&arguments->Func, (arguments->Func.rows > 1) ? i : 0);
+	}
+
+	return NULL;
+}
+
+/* ************************************************************************ */
+/* smoothLevel: "sweeps" iterations of the given method on grid l with the  */
+/* line kernels of the other methods; Jacobi is damped with MG_OMEGA       */
+/* ************************************************************************ */
+static
+void
+smoothLevel (struct calculation_arguments* arguments, struct options* options, int l, int method, int sweeps)
+{
+	int s, i, j, color;
+	struct level* L = &arguments->Level[l];
+	int N = L->N;
+	int colors = (method == METH_RED_BLACK) ? 2 : 1;
+	double const* func;
+	double scale;
+
+	for (s = 0; s < sweeps; s++)
+	{
+		if (method == METH_JACOBI)
+		{
+		#pragma omp parallel for private(func, scale) schedule(static)
+			for (i = 1; i < N; i++)
+			{
+				func = levelFunc(arguments, options, l, i, &scale);
+				jacobiLine(GRID_LINE(&L->V, i), GRID_LINE(&L->U, i - 1), GRID_LINE(&L->U, i),
+				           GRID_LINE(&L->U, i + 1), func, scale, N);
+			}
+
+		#pragma omp parallel for private(j) schedule(static)
+			for (i = 1; i < N; i++)
+			{
+				for (j = 1; j < N; j++)
+				{
+					GRID(&L->U, i, j) += MG_OMEGA * (GRID(&L->V, i, j) - GRID(&L->U, i, j));
+				}
+			}
+		}
+		else
+		{
+			/* red-black: first 1 + (i + 1 + color) % 2, step 2; Gauss-Seidel: 1, 1 */
+			for (color = 0; color < colors; color++)
+			{
+			#pragma omp parallel for private(func, scale) schedule(static) if(method == METH_RED_BLACK)
+				for (i = 1; i < N; i++)
+				{
+					func = levelFunc(arguments, options, l, i, &scale);
+					gaussSeidelLine(GRID_LINE(&L->U, i), GRID_LINE(&L->U, i - 1), GRID_LINE(&L->U, i + 1),
+					                func, scale, N, (colors == 2) ? 1 + (i + 1 + color) % 2 : 1, colors);
+				}
+			}
+		}
+	}
+}
+
+/* ************************************************************************ */
+/* residualLevel: stores the residual b - Au of grid l in V (A: 4u minus    */
+/* the four neighbours) and returns the maximum of |star - u|, the          */
+/* residuum the other methods report                                        */
+/* ************************************************************************ */
+static
+double
+residualLevel (struct calculation_arguments* arguments, struct options* options, int l)
+{
+	int i, j;
+	struct level* L = &arguments->Level[l];
+	int N = L->N;
+	double const* func;
+	double scale;
+	double* r;
+	double const* u;
+	double residuum;
+	double maxresiduum = 0;
+
+	#pragma omp parallel for private(j, func, scale, r, u, residuum) reduction(max:maxresiduum) schedule(static)
+	for (i = 1; i < N; i++)
+	{
+		func = levelFunc(arguments, options, l, i, &scale);
+		r = GRID_LINE(&L->V, i);
+		u = GRID_LINE(&L->U, i);
+
+		residuum = jacobiLine(r, GRID_LINE(&L->U, i - 1), u, GRID_LINE(&L->U, i + 1), func, scale, N);
+		maxresiduum = (residuum < maxresiduum) ? maxresiduum : residuum;
+
+		for (j = 1; j < N; j++)
+		{
+			r[j] = 4 * (r[j] - u[j]);
+		}
+	}
+
+	return maxresiduum;
+}
+
+/* ************************************************************************ */
+/* restrictResidual: right hand side of grid l+1 from the residual of grid  */
+/* l, zero start for its correction. Line i of grid l lies at i * Nc / Nf   */
+/* on grid l+1 (exactly 2I = i if Nf is even); the weights are those of the */
+/* bilinear interpolation, transposed. Because b = h^2 f, the factor        */
+/* (Nc / Nf)^2 of the full weighting cancels against the coarser h.         */
+/* ************************************************************************ */
+static
+void
+restrictResidual (struct calculation_arguments* arguments, int l)
+{
+	int I, J, i, j;
+	struct level* F = &arguments->Level[l];
+	struct level* C = &arguments->Level[l + 1];
+	int Nf = F->N;
+	int Nc = C->N;
+	double wi, wj;
+	double* b;
+	double const* r;
+
+	#pragma omp parallel for private(J, i, j, wi, wj, b, r) schedule(static)
+	for (I = 0; I <= Nc; I++)
+	{
+		b = GRID_LINE(&C->B, I);
+
+		for (J = 0; J <= Nc; J++)
+		{
+			GRID(&C->U, I, J) = 0;
+			b[J] = 0;
+		}
+
+		if (0 == I || I == Nc)
+		{
+			continue;
+		}
+
+		/* fine lines with a positive weight: (I-1) Nf < i Nc < (I+1) Nf */
+		for (i = (I - 1) * Nf / Nc + 1; i <= ((I + 1) * Nf - 1) / Nc; i++)
+		{
+			wi = 1.0 - (double)abs(i * Nc - I * Nf) / Nf;
+			r = GRID_LINE(&F->V, i);
+
+			for (J = 1; J < Nc; J++)
+			{
+				for (j = (J - 1) * Nf / Nc + 1; j <= ((J + 1) * Nf - 1) / Nc; j++)
+				{
+					wj = 1.0 - (double)abs(j * Nc - J * Nf) / Nf;
+					b[J] += wi * wj * r[j];
+				}
+			}
+		}
+	}
+}
+
+/* ************************************************************************ */
+/* prolongate: adds the correction of grid l+1, interpolated bilinearly, to */
+/* the inner points of grid l                                               */
+/* ************************************************************************ */
+static
+void
+prolongate (struct calculation_arguments* arguments, int l)
+{
+	int I, J, i, j;
+	struct level* F = &arguments->Level[l];
+	struct level* C = &arguments->Level[l + 1];
+	int Nf = F->N;
+	int Nc = C->N;
+	double wi, wj;
+	double* u;
+	double const* c0;
+	double const* c1;
+
+	#pragma omp parallel for private(I, J, j, wi, wj, u, c0, c1) schedule(static)
+	for (i = 1; i < Nf; i++)
+	{
+		I = i * Nc / Nf;
+		wi = (double)(i * Nc - I * Nf) / Nf;
+		u = GRID_LINE(&F->U, i);
+		c0 = GRID_LINE(&C->U, I);
+		c1 = GRID_LINE(&C->U, I + 1);
+
+		for (j = 1; j < Nf; j++)
+		{
+			J = j * Nc / Nf;
+			wj = (double)(j * Nc - J * Nf) / Nf;
+			u[j] += (1 - wi) * ((1 - wj) * c0[J] + wj * c0[J + 1]) + wi * ((1 - wj) * c1[J] + wj * c1[J + 1]);
+		}
+	}
+}
+
+/* ************************************************************************ */
+/* cycleLevel: one multigrid cycle on grid l. V-cycle: smooth, correct with */
+/* one cycle on grid l+1, smooth. F-cycle: the correction is an F-cycle     */
+/* followed by a V-cycle. The coarsest grid is solved with MG_COARSE_SWEEPS */
+/* Gauss-Seidel sweeps.                                                     */
+/* ************************************************************************ */
+static
+void
+cycleLevel (struct calculation_arguments* arguments, struct options* options, int l, int cycle)
+{
+	if (l == arguments->levels - 1)
+	{
+		smoothLevel(arguments, options, l, METH_GAUSS_SEIDEL, MG_COARSE_SWEEPS);
+		return;
+	}
+
+	TRACE_BEGIN(0, "smooth");
+	smoothLevel(arguments, options, l, options->smoother, MG_SWEEPS);
+	TRACE_END(0);
+	TRACE_BEGIN(0, "restrict");
+	residualLevel(arguments, options, l);
+	restrictResidual(arguments, l);
+	TRACE_END(0);
+
+	cycleLevel(arguments, options, l + 1, cycle);
+
+	if (cycle == CYCLE_F)
+	{
+		cycleLevel(arguments, options, l + 1, CYCLE_V);
+	}
+
+	TRACE_BEGIN(0, "prolongate");
+	prolongate(arguments, l);
+	TRACE_END(0);
+	TRACE_BEGIN(0, "smooth");
+	smoothLevel(arguments, options, l, options->smoother, MG_SWEEPS);
+	TRACE_END(0);
+}
+
+/* ************************************************************************ */
+/* calculateMultigrid: solves the equation with multigrid cycles on         */
+/* Matrix[0]. One cycle counts as one iteration, its residuum is that of a  */
+/* Jacobi sweep after the cycle.                                            */
+/* ************************************************************************ */
+static
+void
+calculateMultigrid (struct calculation_arguments* arguments, struct calculation_results *results, struct options* options)
+{
+	double maxresiduum;
+
+	while (options->term_iteration > 0)
+	{
+		TRACE_BEGIN(0, "cycle");
+		cycleLevel(arguments, options, 0, options->cycle);
+		TRACE_END(0);
+		TRACE_BEGIN(0, "residual");
+		maxresiduum = residualLevel(arguments, options, 0);
+		TRACE_END(0);
+
+		results->stat_iteration++;
+		results->stat_precision = maxresiduum;
+
+		/* check for stopping calculation, depending on termination method */
+		if (options->termination == TERM_PREC)
+		{
+			if (maxresiduum < options->term_precision)
+			{
+				options->term_iteration = 0;
+			}
+		}
+		else if (options->termination == TERM_ITER)
+		{
+			options->term_iteration--;
+		}
+	}
+
+	results->m = 0;
+}
+
+/* ************************************************************************ */
+/* calculateCG: solves the equation with the conjugate gradient method,     */
+/* matrix-free: A is 4u minus the four neighbours on the inner points, the  */
+/* right hand side holds the forcing term and the border. Matrix[1..3] are  */
+/* the residual r, the direction p and q = Ap, all with a zero border.      */
+/* The residuum of an iteration is max |r| / 4 = max |star - u|, the one a  */
+/* Jacobi sweep would report at the same approximation.                     */
+/* ************************************************************************ */
+static
+void
+calculateCG (struct calculation_arguments* arguments, struct calculation_results *results, struct options* options)
+{
+	int g, i, j;
+	int N = arguments->N;
+	struct grid* U = &arguments->Matrix[0];
+	struct grid* R = &arguments->Matrix[1];
+	struct grid* P = &arguments->Matrix[2];
+	struct grid* Q = &arguments->Matrix[3];
+	double const* func = NULL;                  /* forcing term of line i and its line factor     */
+	double scale = 0;
+	double* u;
+	double* r;
+	double* p;
+	double* q;
+	double rr = 0;                              /* (r,r) of the current and the next iteration    */
+	double rr_new;
+	double pq;                                  /* (p,Ap)                                         */
+	double alpha, beta;
+	double maxresiduum;
+
+	for (g = 1; g <= 3; g++)
+	{
+		for (i = 0; i <= N; i++)
+		{
+			GRID(&arguments->Matrix[g], 0, i) = 0;
+			GRID(&arguments->Matrix[g], N, i) = 0;
+			GRID(&arguments->Matrix[g], i, 0) = 0;
+			GRID(&arguments->Matrix[g], i, N) = 0;
+		}
+	}
+
+	/* r = b - Au = 4 (star - u), p = r */
+	#pragma omp parallel for private(j, u, r, p) firstprivate(func, scale) reduction(+:rr) schedule(static)
+	for (i = 1; i < N; i++)
+	{
+		if (options->inf_func == FUNC_FPISIN)
+		{
+			func = GRID_LINE(&arguments->Func, (arguments->Func.rows > 1) ? i : 0);
+			scale = GRID(&arguments->FuncScale, 0, i);
+		}
+
+		u = GRID_LINE(U, i);
+		r = GRID_LINE(R, i);
+		p = GRID_LINE(P, i);
+		jacobiLine(r, GRID_LINE(U, i - 1), u, GRID_LINE(U, i + 1), func, scale, N);
+
+		for (j = 1; j < N; j++)
+		{
+			r[j] = 4 * (r[j] - u[j]);
+			p[j] = r[j];
+			rr += r[j] * r[j];
+		}
+	}
+
+	while (options->term_iteration > 0)
+	{
+		TRACE_BEGIN(0, "iteration");
+		pq = 0;
+		rr_new = 0;
+		maxresiduum = 0;
+
+		/* q = Ap */
+		#pragma omp parallel for private(j, p, q) reduction(+:pq) schedule(static)
+		for (i = 1; i < N; i++)
+		{
+			p = GRID_LINE(P, i);
+			q = GRID_LINE(Q, i);
+
+			for (j = 1; j < N; j++)
+			{
+				q[j] = 4 * p[j] - (GRID(P, i - 1, j) + p[j - 1] + p[j + 1] + GRID(P, i + 1, j));
+				pq += p[j] * q[j];
+			}
+		}
+
+		alpha = (pq > 0) ? rr / pq : 0;
+
+		/* u = u + alpha p, r = r - alpha q */
+		#pragma omp parallel for private(j, u, r, p, q) reduction(+:rr_new) reduction(max:maxresiduum) schedule(static)
+		for (i = 1; i < N; i++)
+		{
+			u = GRID_LINE(U, i);
+			r = GRID_LINE(R, i);
+			p = GRID_LINE(P, i);
+			q = GRID_LINE(Q, i);
+
+			for (j = 1; j < N; j++)
+			{
+				u[j] += alpha * p[j];
+				r[j] -= alpha * q[j];
+				rr_new += r[j] * r[j];
+				maxresiduum = (fabs(r[j]) < maxresiduum) ? maxresiduum : fabs(r[j]);
+			}
+		}
+
+		beta = (rr > 0) ? rr_new / rr : 0;
+		rr = rr_new;
+
+		/* p = r + beta p */
+		#pragma omp parallel for private(j, r, p) schedule(static)
+		for (i = 1; i < N; i++)
+		{
+			r = GRID_LINE(R, i);
+			p = GRID_LINE(P, i);
+
+			for (j = 1; j < N; j++)
+			{
+				p[j] = r[j] + beta * p[j];
+			}
+		}
+
+		TRACE_END(0);
+
+		results->stat_iteration++;
+		results->stat_precision = maxresiduum * 0.25;
+
+		/* check for stopping calculation, depending on termination method */
+		if (options->termination == TERM_PREC)
+		{
+			if (results->stat_precision < options->term_precision)
+			{
+				options->term_iteration = 0;
+			}
+		}
+		else if (options->termination == TERM_ITER)
+		{
+			options->term_iteration--;
+		}
+	}
+
+	results->m = 0;
+}
+
+/* ************************************************************************ */
+/* calculateMixed: Jacobi with mixed precision. The sweeps run in float on  */
+/* the correction e of the approximation u: with d = star(u) - u as         */
+/* forcing term, Jacobi for e starting from e = 0 gives u + e = the same    */
+/* iterations as Jacobi for u, but e is small, so float loses nothing that  */
+/* matters. Half the bytes per point halve the memory traffic and the       */
+/* float kernel calculates twice the points per instruction. After the      */
+/* float residuum fell by MIXED_REDUCTION (or has not fallen for            */
+/* MIXED_STALL iterations), a double pass adds e to u and calculates the    */
+/* residuum and d anew (refinement), so term_precision is checked in double. */
+/* ************************************************************************ */
+static
+void
+calculateMixed (struct calculation_arguments* arguments, struct calculation_results *results, struct options* options)
+{
+	int i, j;
+	int m1, m2;
+	int N = arguments->N;
+	int n;                                      /* float iterations of this correction            */
+	int stall;                                  /* iterations since the last new minimum          */
+	struct grid* U = &arguments->Matrix[0];     /* approximation                                  */
+	struct grid* Star = &arguments->Matrix[1];  /* its Jacobi iteration                           */
+	struct fgrid E[2];                          /* correction, two Jacobi matrices in float       */
+	struct fgrid D;                             /* star - u, forcing term of the correction       */
+	double const* func = NULL;                  /* forcing term of line i and its line factor     */
+	double scale = 0;
+	double residuum;
+	double maxresiduum;
+	float fresiduum;
+	float fmaxresiduum;
+	float best = 0;                             /* smallest float residuum of this correction     */
+	float limit;
+	double start;
+
+	allocateFloatGrid(&E[0], N + 1, N + 1);
+	allocateFloatGrid(&E[1], N + 1, N + 1);
+	allocateFloatGrid(&D, N + 1, N + 1);
+
+	/* first touch by the thread that calculates the line */
+	#pragma omp parallel for private(j) schedule(static)
+	for (i = 0; i <= N; i++)
+	{
+		for (j = 0; j <= N; j++)
+		{
+			GRID(&E[0], i, j) = 0;
+			GRID(&E[1], i, j) = 0;
+			GRID(&D, i, j) = 0;
+		}
+	}
+
+	while (1)
+	{
+		/* double: residuum of u and forcing term of the correction */
+		TRACE_BEGIN(0, "double pass");
+		maxresiduum = 0;
+
+		#pragma omp parallel for private(j, residuum) firstprivate(func, scale) reduction(max:maxresiduum) schedule(static)
+		for (i = 1; i < N; i++)
+		{
+			if (options->inf_func == FUNC_FPISIN)
+			{
+				func = GRID_LINE(&arguments->Func, (arguments->Func.rows > 1) ? i : 0);
+				scale = GRID(&arguments->FuncScale, 0, i);
+			}
+
+			residuum = jacobiLine(GRID_LINE(Star, i), GRID_LINE(U, i - 1), GRID_LINE(U, i), GRID_LINE(U, i + 1), func, scale, N);
+			maxresiduum = (residuum < maxresiduum) ? maxresiduum : residuum;
+
+			for (j = 1; j < N; j++)
+			{
+				GRID(&D, i, j) = (float)(GRID(Star, i, j) - GRID(U, i, j));
+			}
+		}
+
+		TRACE_END(0);
+
+		results->stat_precision = maxresiduum;
+		results->stat_refinements++;
+
+		if (options->term_iteration == 0 || maxresiduum < options->term_precision)
+		{
+			break;
+		}
+
+		/* float: Jacobi for the correction, from e = 0 */
+		start = omp_get_wtime();
+
+		#pragma omp parallel for private(j) schedule(static)
+		for (i = 1; i < N; i++)
+		{
+			for (j = 1; j < N; j++)
+			{
+				GRID(&E[0], i, j) = 0;
+				GRID(&E[1], i, j) = 0;
+			}
+		}
+
+		m1 = 0; m2 = 1;
+		n = 0;
+		stall = 0;
+		limit = maxresiduum * MIXED_REDUCTION;
+		limit = (limit < options->term_precision) ? options->term_precision : limit;
+
+		while (options->term_iteration > 0)
+		{
+			fmaxresiduum = 0;
+
+			TRACE_BEGIN(0, "float sweep");
+			#pragma omp parallel for private(fresiduum) reduction(max:fmaxresiduum) schedule(static)
+			for (i = 1; i < N; i++)
+			{
+				fresiduum = jacobiLineFloat(GRID_LINE(&E[m1], i), GRID_LINE(&E[m2], i - 1), GRID_LINE(&E[m2], i),
+				                            GRID_LINE(&E[m2], i + 1), GRID_LINE(&D, i), 1.0f, N);
+				fmaxresiduum = (fresiduum < fmaxresiduum) ? fmaxresiduum : fresiduum;
+			}
+			TRACE_END(0);
+
+			results->stat_iteration++;
+			results->stat_float_iteration++;
+
+			/* exchange m1 and m2 */
+			i=m1; m1=m2; m2=i;
+
+			if (options->termination == TERM_ITER)
+			{
+				options->term_iteration--;
+			}
+
+			stall = (n == 0 || fmaxresiduum < best) ? 0 : stall + 1;
+			best = (stall > 0) ? best : fmaxresiduum;
+			n++;
+
+			if (fmaxresiduum < limit || stall >= MIXED_STALL)
+			{
+				break;
+			}
+		}
+
+		/* double: u = u + e */
+		TRACE_BEGIN(0, "refinement");
+		#pragma omp parallel for private(j) schedule(static)
+		for (i = 1; i < N; i++)
+		{
+			for (j = 1; j < N; j++)
+			{
+				GRID(U, i, j) += GRID(&E[m2], i, j);
+			}
+		}
+		TRACE_END(0);
+
+		results->stat_float_time += omp_get_wtime() - start;
+	}
+
+	freeFloatGrid(&E[0]);
+	freeFloatGrid(&E[1]);
+	freeFloatGrid(&D);
+
+	/* like Jacobi in double: the last iteration and the residuum before it */
+	results->m = 1;
+}
+
+/* ************************************************************************ */
+/* calculate: solves the equation                                           */
+/* Jacobi and red-black: all iterations run in one parallel region. The     */
+/* lines of a sweep (or of one color) are shared out with "omp for"; the    */
+/* only synchronization is the barrier after each sweep. Every thread       */
+/* leaves its maximum residuum in its own cache line of Slots, line         */
+/* iteration % 2, so the slots of the next iteration can be written while   */
+/* slow threads still read these. All threads take the termination          */
+/* decision from the same slots, thread 0 updates results.                  */
+/* ************************************************************************ */
+static
+void
+calculate (struct calculation_arguments* arguments, struct calculation_results *results, struct options* options)
+{
+	int N = arguments->N;
+	int per_line = GRID_ALIGNMENT / sizeof(double);  /* one slot per cache line              */
+	struct grid* Matrix = arguments->Matrix;
+	struct grid Slots;                          /* maximum residuum per thread and iteration      */
+
+	/* Jacobi in float with refinement in double */
+	if (options->mixed)
+	{
+		calculateMixed(arguments, results, options);
+		return;
+	}
+
+	/* Jacobi: several iterations per pass over the matrix */
+	if (arguments->temporal > 0)
+	{
+		calculateTemporal(arguments, results, options);
+		return;
+	}
+
+	if (options->method == METH_MULTIGRID)
+	{
+		calculateMultigrid(arguments, results, options);
+		return;
+	}
+
+	if (options->method == METH_CG)
+	{
+		calculateCG(arguments, results, options);
+		return;
+	}
+
+	/* lexicographic Gauss-Seidel: tiles as tasks with dependencies */
+	if (options->method == METH_GAUSS_SEIDEL)
+	{
+		calculateGaussSeidel(arguments, results, options);
+		return;
+	}
+
+	allocateGrid(&Slots, 2, omp_get_max_threads() * per_line);
+
+	#pragma omp parallel default(shared)
+	{
+		int i, k;                                   /* local variables for loops                      */
+		int m1, m2;                                 /* used as indices for old and new matrices       */
+		int color;                                  /* red-black: 2 sweeps per iteration              */
+		int colors = (options->method == METH_RED_BLACK || options->method == METH_SOR) ? 2 : 1;
+		int iteration;
+		int term_iteration = options->term_iteration;  /* same in every thread                  */
+		int me = omp_get_thread_num();
+		int threads = omp_get_num_threads();
+		int due;                                    /* the residuum of this iteration is merged       */
+		struct residual schedule = residual;        /* the same decisions in every thread             */
+		double residuum;                            /* residuum of current line                       */
+		double t_maxresiduum;                       /* maximum residuum of this thread                */
+		double maxresiduum = 0;                     /* maximum residuum of all threads                */
+		double wait = 0;                            /* time at the barriers                           */
+		double start;
+
+		/* initialize m1 and m2 depending on algorithm */
+		if (options->method == METH_JACOBI)
+		{
+			m1=0; m2=1;
+		}
+		else
+		{
+			m1=0; m2=0;
+		}
+
+		for (iteration = 0; term_iteration > 0; iteration++)
+		{
+			due = residualDue(&schedule, iteration + 1, term_iteration == 1);
+			t_maxresiduum = 0;
+
+			/* red-black: all red points (i + j even) first, then all black points; */
+			/* the lines of one color can be calculated in parallel                 */
+			for (color = 0; color < colors; color++)
+			{
+				TRACE_BEGIN(me, "sweep");
+				#pragma omp for schedule(static) nowait
+				for (i = 1; i < N; i++)
+				{
+					/* lines are private to the thread calculating line i */
+					double* out = GRID_LINE(&Matrix[m1], i);
+					double const* up = GRID_LINE(&Matrix[m2], i - 1);
+					double const* mid = GRID_LINE(&Matrix[m2], i);
+					double const* down = GRID_LINE(&Matrix[m2], i + 1);
+					double const* func = NULL;
+					double scale = 0;
+
+					if (options->inf_func == FUNC_FPISIN)
+					{
+						func = GRID_LINE(&arguments->Func, (arguments->Func.rows > 1) ? i : 0);
+						scale = GRID(&arguments->FuncScale, 0, i);
+					}
+
+					if (options->method == METH_JACOBI)
+					{
+						/* vectorized line kernel (stencil.c) */
+						residuum = jacobiLine(out, up, mid, down, func, scale, N);
+					}
+					else if (options->method == METH_SOR)
+					{
+						/* red-black, over-relaxed by omega */
+						residuum = sorLine(out, up, down, func, scale, arguments->omega, N, 1 + (i + 1 + color) % 2, 2);
+					}
+					else
+					{
+						/* red-black: only the points with (i + j) % 2 == color */
+						residuum = gaussSeidelLine(out, up, down, func, scale, N, 1 + (i + 1 + color) % 2, 2);
+					}
+
+					t_maxresiduum = (residuum < t_maxresiduum) ? t_maxresiduum : residuum;
+				}
+
+				if (due)
+				{
+					GRID(&Slots, iteration % 2, me * per_line) = t_maxresiduum;
+				}
+				TRACE_END(me);
+
+				/* the sweep (color) is complete in all threads */
+				TRACE_BEGIN(me, "barrier");
+				start = omp_get_wtime();
+				#pragma omp barrier
+				wait += omp_get_wtime() - start;
+				TRACE_END(me);
+			}
+
+			/* every thread merges the maxima of all threads itself */
+			if (due)
+			{
+				TRACE_BEGIN(me, "merge");
+				start = omp_get_wtime();
+				maxresiduum = 0;
+				for (k = 0; k < threads; k++)
+				{
+					maxresiduum = (GRID(&Slots, iteration % 2, k * per_line) < maxresiduum) ? maxresiduum : GRID(&Slots, iteration % 2, k * per_line);
+				}
+				residualUpdate(&schedule, iteration + 1, maxresiduum, options->term_precision);
+				schedule.time += omp_get_wtime() - start;
+				TRACE_END(me);
+			}
+
+			/* exchange m1 and m2 */
+			i=m1; m1=m2; m2=i;
+
+			/* check for stopping calculation, depending on termination method */
+			TRACE_BEGIN(me, "termination");
+			if (options->termination == TERM_PREC)
+			{
+				if (due && maxresiduum < options->term_precision)
+				{
+					term_iteration = 0;
+				}
+			}
+			else if (options->termination == TERM_ITER)
+			{
+				term_iteration--;
+			}
+			TRACE_END(me);
+
+			if (0 == me)
+			{
+				results->stat_iteration++;
+
+				if (due)
+				{
+					results->stat_precision = maxresiduum;
+				}
+			}
+		}
+
+		#pragma omp atomic
+		results->stat_overhead += wait / threads;
+
+		if (0 == me)
+		{
+			options->term_iteration = term_iteration;
+			results->m = m2;
+			residual = schedule;
+		}
+	}
+
+	freeGrid(&Slots);
+}
+
+/* ************************************************************************ */
+/* trafficModel: bytes from and to memory per point and iteration for the   */
+/* roofline report, compulsory traffic without write allocate as in         */
+/* benchmark.sh: every pass reads and writes each matrix value once and     */
+/* reads the forcing term table (the separable form stays in the cache).    */
+/* Describes the layout in model; 0: no model for the method                */
+/* ************************************************************************ */
+static
+double
+trafficModel (struct calculation_arguments* arguments, struct options* options, char* model, size_t size)
+{
+	int passes = (options->method == METH_RED_BLACK || options->method == METH_SOR) ? 2 : 1;
+	int table = (options->inf_func == FUNC_FPISIN && arguments->Func.rows > 1);
+	char const* matrix = (options->method == METH_JACOBI) ? "2 Matrizen" : "1 Matrix";
+	double bytes = 16.0 * passes + ((table) ? 8.0 * passes : 0);
+
+	if (options->method == METH_MULTIGRID || options->method == METH_CG)
+	{
+		snprintf(model, size, "keines fuer %s", (options->method == METH_CG) ? "CG" : "Mehrgitter");
+		return 0;
+	}
+
+	/* float correction: read and write 4 bytes, read the right side (4) */
+	if (options->mixed)
+	{
+		bytes = 12.0;
+		matrix = "Korrektur float";
+	}
+
+	/* temporal blocking: one pass over the matrix per wavefront */
+	if (arguments->temporal > 0)
+	{
+		bytes /= arguments->temporal;
+	}
+
+	snprintf(model, size, "%.1f Byte pro Punkt (%s, Stoerfunktion %s)", bytes, matrix,
+	         (options->inf_func == FUNC_F0) ? "keine" : (table) ? "Tabelle" : "separabel");
+
+	return bytes;
+}
+
+/* ************************************************************************ */
+/*  displayStatistics: displays some statistics about the calculation       */
+/* ************************************************************************ */
+static
+void
+displayStatistics (struct calculation_arguments* arguments, struct calculation_results *results, struct options* options)
+{
+	int N = arguments->N;
+
+	double time = (comp_time.tv_sec - start_time.tv_sec) + (comp_time.tv_usec - start_time.tv_usec) * 1e-6;
+	printf("Berechnungszeit:    %f s \n", time);
+
+	//Calculate Flops
+	// star op = 5 ASM ops (+1 XOR) with -O3, matrix korrektur = 1
+	double q = 6;
+	double q_func = 0;
+	double mflops;
+
+	// residuum: checked 1 flop in ASM, verified on Nehalem architecture.
+	q += 1.0;
+
+	if (options->method == METH_SOR)
+	{
+		// over-relaxation: one multiplication with omega and one addition
+		q += 2.0;
+	}
+
+	if (options->inf_func == FUNC_FPISIN)
+	{
+		// forcing term: precomputed, one multiplication with the line factor and one addition
+		q_func = 2.0;
+	}
+
+	/* calculate flops, with and without the forcing term */
+	mflops = ((q + q_func) * (N - 1) * (N - 1) * results->stat_iteration) * 1e-6;
+	printf("Executed float ops: %f MFlop\n", mflops);
+	printf("Speed:              %f MFlop/s\n", mflops / time);
+	printf("Speed ohne Stoerf.: %f MFlop/s\n", (q * (N - 1) * (N - 1) * results->stat_iteration) * 1e-6 / time);
+
+	if (counters != NULL)
+	{
+		counterReport(counters, omp_get_max_threads(), "Thread", mflops, time);
+	}
+
+	if (roofline != NULL)
+	{
+		char model[160];
+		double bytes = trafficModel(arguments, options, model, sizeof(model));
+
+		rooflineReport(roofline, omp_get_max_threads(), "Threads", mflops, bytes * (N - 1) * (N - 1) * results->stat_iteration * 1e-6, time, model);
+	}
+
+	printf("Berechnungsmethode: ");
+
+	if (options->method == METH_GAUSS_SEIDEL)
+	{
+		printf("Gauss-Seidel");
+	}
+	else if (options->method == METH_JACOBI)
+	{
+		printf("Jacobi");
+	}
+	else if (options->method == METH_RED_BLACK)
+	{
+		printf("Gauss-Seidel (Rot-Schwarz)");
+	}
+	else if (options->method == METH_MULTIGRID)
+	{
+		printf("Mehrgitterverfahren");
+	}
+	else if (options->method == METH_CG)
+	{
+		printf("Konjugierte Gradienten");
+	}
+	else if (options->method == METH_SOR)
+	{
+		printf("SOR (Rot-Schwarz)");
+	}
+
+	printf("\n");
+	printf("Rechenkern:         %s\n", stencilName());
+	printf("Anzahl Threads:     %d (%d Prozessoren)\n", omp_get_max_threads(), omp_get_num_procs());
+	printf("Thread-Bindung:     %s\n", (NULL != options->affinity) ? options->affinity : "keine");
+
+	if (arguments->temporal == 0 && options->method != METH_GAUSS_SEIDEL && !options->mixed && results->stat_iteration > 0)
+	{
+		printf("Synchronisation:    %f us pro Iteration\n", results->stat_overhead * 1e6 / results->stat_iteration);
+	}
+
+	if (options->method == METH_GAUSS_SEIDEL)
+	{
+		printf("Kacheln:            %d x %d Punkte, %d Iterationen pro Taskgraph\n", arguments->tile, arguments->tile, GS_CHUNK);
+	}
+
+	if (options->method == METH_MULTIGRID)
+	{
+		printf("Mehrgitter:         %s-Zyklus, %d Gitter (%d .. %d), Glaetter %s\n", (options->cycle == CYCLE_F) ? "F" : "V",
+		       arguments->levels, arguments->N, arguments->Level[arguments->levels - 1].N,
+		       (options->smoother == METH_JACOBI) ? "Jacobi" : ((options->smoother == METH_RED_BLACK) ? "Rot-Schwarz" : "Gauss-Seidel"));
+	}
+
+	if (options->method == METH_SOR)
+	{
+		printf("Relaxation:         omega = %f (%s)\n", arguments->omega, (options->omega > 0) ? "--omega" : "2/(1+sin(pi h))");
+	}
+
+	if (options->mixed)
+	{
+		printf("Genauigkeit:        %d Iterationen float (%f s), %d Korrekturen double (%f s)\n", results->stat_float_iteration,
+		       results->stat_float_time, results->stat_refinements, time - results->stat_float_time);
+	}
+
+	if (arguments->temporal > 0)
+	{
+		printf("Zeitblockung:       %d Iterationen, Baender von %d Spalten\n", arguments->temporal, arguments->width);
+	}
+
+	residualReport(&residual, results->stat_iteration);
+
+	printf("Interlines:         %d\n",options->interlines);
+	printf("Stoerfunktion:      ");
+
+	if (options->inf_func == FUNC_F0)
+	{
+		printf("f(x,y)=0");
+	}
+	else if (options->inf_func == FUNC_FPISIN)
+	{
+		printf("f(x,y)=2pi^2*sin(pi*x)sin(pi*y)");
+	}
+
+	printf("\n");
+	printf("Terminierung:       ");
+
+	if (options->termination == TERM_PREC)
+	{
+		printf("Hinreichende Genaugkeit");
+	}
+	else if (options->termination == TERM_ITER)
+	{
+		printf("Anzahl der Iterationen");
+	}
+
+	printf("\n");
+	printf("Anzahl Iterationen: %d\n", results->stat_iteration);
+	printf("Norm des Fehlers:   %e\n", results->stat_precision);
+}
+
+/* ************************************************************************ */
+/*  main                                                                    */
+/* ************************************************************************ */
+int
+main (int argc, char** argv)
+{
+	struct options options;
+	struct calculation_arguments arguments;
+	struct calculation_results results; 
+
+	/* get parameters */
+	AskParams(&options, argc, argv);              /* ************************* */
+	initStencil();                                /*  select line kernel       */
+	omp_set_num_threads(options.number);          /*  number of OpenMP threads */
+	pinThreads(&options);                         /*  --affinity               */
+
+	initVariables(&arguments, &results, &options);           /* ******************************************* */
+
+	allocateMatrices(&arguments);        /*  get and initialize variables and matrices  */
+	initMatrices(&arguments, &options);            /* ******************************************* */
+	initFunction(&arguments, &options);            /*  precompute forcing term                    */
+	measureBandwidth(&arguments);                  /*  read bandwidth per socket                  */
+
+	/* --roofline: all threads probe at the same time, bound as in calculate(), */
+	/* one entry per thread of the team, which need not be options.number       */
+	if (options.roofline)
+	{
+		roofline = calloc(omp_get_max_threads(), sizeof(struct roofline));
+
+		#pragma omp parallel
+		rooflineProbe(&roofline[omp_get_thread_num()], ROOFLINE_ELEMENTS / omp_get_num_threads());
+	}
+
+	if (counterEnabled())
+	{
+		counters = calloc(omp_get_max_threads(), sizeof(struct counters));
+	}
+
+	/* PARTDIFF_TRACE=<file>: events of calculate(), one buffer per thread */
+	if (traceWanted())
+	{
+		traceInit(omp_get_max_threads(), 0);
+	}
+
+	residualInit(&residual, options.adaptive, options.termination == TERM_PREC, options.method != METH_SOR);
+
+	gettimeofday(&start_time, NULL);                   /*  start timer         */
+
+	/* every thread counts itself; the team is reused by all parallel regions */
+	if (counters != NULL)
+	{
+		#pragma omp parallel
+		counterStart(&counters[omp_get_thread_num()]);
+	}
+
+	calculate(&arguments, &results, &options);                                      /*  solve the equation  */
+
+	if (counters != NULL)
+	{
+		#pragma omp parallel
+		counterStop(&counters[omp_get_thread_num()]);
+	}
 
-	gettimeofday(&start_time, NULL);                   /*  start timer         */
-	calculate(&arguments, &results, &options);                                      /*  solve the equation  */
 	gettimeofday(&comp_time, NULL);                   /*  stop timer          */
 
 	displayStatistics(&arguments, &results, &options);                                  /* **************** */
 	DisplayMatrix("Matrix:",                              /*  display some    */
-			arguments.Matrix[results.m][0], options.interlines);            /*  statistics and  */
+			&arguments.Matrix[results.m], options.interlines);            /*  statistics and  */
 
 	freeMatrices(&arguments);                                       /*  free memory     */
+	free(counters);
+	free(roofline);
+	traceFinish();
 
 	return 0;
 }
@@ -0,0 +1,1074 @@
+/****************************************************************************/
+/****************************************************************************/
+/**                                                                        **/
+/**                TU Muenchen - Institut fuer Informatik                  **/
+/**                                                                        **/
+/** Copyright: Prof. Dr. Thomas Ludwig                                     **/
+/**            Andreas C. Schmidt                                          **/
+/**            JK und andere  besseres Timing, FLOP Berechnung             **/
+/**                                                                        **/
+/** File:      partdiff-pthreads.c                                         **/
+/**                                                                        **/
+/** Purpose:   Partial differential equation solver for Gauss-Seidel and   **/
+/**            Jacobi method, parallelized with POSIX threads (no OpenMP). **/
+/**            The threads are created once and kept in a pool; every     **/
+/**            thread owns a fixed block of lines.                         **/
+/**                                                                        **/
+/****************************************************************************/
+/****************************************************************************/
+
+/* ************************************************************************ */
+/* Include standard header file.                                            */
+/* ************************************************************************ */
+#define _XOPEN_SOURCE 600                       /* clock_gettime, sched_yield */
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <malloc.h>
+#include <time.h>
+#include <sys/time.h>
+#include "partdiff-seq.h"
+#include "stencil.h"
+#include "counters.h"
+#include "roofline.h"
+#include "trace.h"
+#include "residual.h"
+
+
+struct calculation_arguments
+{
+	int     N;              /* number of spaces between lines (lines=N+1)     */
+	int     num_matrices;   /* number of matrices                             */
+	struct grid Matrix[3];  /* matrices with real values (Jacobi: 2 or 3)     */
+	struct grid Func;       /* forcing term without line factor (initFunction) */
+	struct grid FuncScale;  /* line factors of the forcing term               */
+	double  h;              /* length of a space between two lines            */
+	double  omega;          /* SOR: relaxation factor                         */
+	int     temporal;       /* Jacobi: iterations per wavefront, 0: sweeps    */
+	int     width;          /* columns per band of a wavefront                */
+};
+
+struct calculation_results
+{
+	int     m;
+	int     stat_iteration; /* number of current iteration                    */
+	double  stat_precision; /* actual precision of all slaves in iteration    */
+	double  stat_overhead;  /* seconds per thread waiting at barriers         */
+};
+
+/* ************************************************************************ */
+/* A sense-reversing barrier: every thread flips its local sense, the last  */
+/* thread to arrive resets the counter and sets the shared sense to it,     */
+/* the others wait until the shared sense equals their local one. The      */
+/* barrier can be used again at once, there is no second phase.             */
+/* ************************************************************************ */
+struct barrier
+{
+	int     threads;        /* number of threads                              */
+	int     count;          /* threads still to arrive                        */
+	int     sense;          /* set by the last thread to arrive               */
+};
+
+struct worker
+{
+	int     id;             /* 0: the main thread                             */
+	int     first;          /* first own line                                 */
+	int     last;           /* last own line (first - 1: none)                */
+	int     sense;          /* local sense for the barrier                    */
+	double  wait;           /* seconds spent at barriers in calculate          */
+	pthread_t thread;
+	char    pad[GRID_ALIGNMENT]; /* no two workers in one cache line       */
+};
+
+struct pool
+{
+	int     threads;        /* number of workers, including the main thread   */
+	struct worker* workers;
+	struct barrier barrier;
+	void    (*job) (struct worker*);  /* run by every worker, NULL: quit     */
+	struct calculation_arguments* arguments;  /* arguments of the job      */
+	struct calculation_results* results;
+	struct options* options;
+	struct grid Slots;      /* maximum residuum per worker and iteration      */
+	double  residuals[TEMPORAL_MAX];  /* wavefront: residuum per iteration */
+};
+
+/* ************************************************************************ */
+/* Global variables                                                         */
+/* ************************************************************************ */
+
+/* time measurement variables */
+struct timeval start_time;       /* time when program started                      */
+struct timeval comp_time;        /* time when calculation completed                */
+
+/* hardware counters around calculate(), one per worker, NULL if not wanted (PARTDIFF_COUNTERS) */
+struct counters* counters = NULL;
+
+/* bandwidth and peak probes, one per worker, NULL without --roofline */
+struct roofline* roofline = NULL;
+
+/* evaluations of the residuum (--residual=adaptive) */
+struct residual residual;
+
+struct pool pool;                /* the worker threads                             */
+
+/* ************************************************************************ */
+/* barrierWait: waits until all workers of the pool have arrived            */
+/* ************************************************************************ */
+static
+void
+barrierWait (struct worker* w)
+{
+	int spin = 0;
+	struct barrier* b = &pool.barrier;
+
+	w->sense = !w->sense;
+
+	if (__atomic_sub_fetch(&b->count, 1, __ATOMIC_ACQ_REL) == 0)
+	{
+		__atomic_store_n(&b->count, b->threads, __ATOMIC_RELAXED);
+		__atomic_store_n(&b->sense, w->sense, __ATOMIC_RELEASE);
+	}
+	else
+	{
+		while (__atomic_load_n(&b->sense, __ATOMIC_ACQUIRE) != w->sense)
+		{
+			/* more threads than processors: let the others run */
+			if (++spin > BARRIER_SPIN)
+			{
+				sched_yield();
+			}
+		}
+	}
+}
+
+/* ************************************************************************ */
+/* syncWorkers: barrierWait inside the calculation, with time measurement  */
+/* ************************************************************************ */
+static
+void
+syncWorkers (struct worker* w)
+{
+	struct timespec start, end;
+
+	TRACE_BEGIN(w->id, "barrier");
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	barrierWait(w);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	TRACE_END(w->id);
+
+	w->wait += (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+}
+
+/* ************************************************************************ */
+/* workerMain: the loop of the worker threads: wait for a job, run it,     */
+/* wait until all workers have finished it                                  */
+/* ************************************************************************ */
+static
+void*
+workerMain (void* arg)
+{
+	struct worker* w = arg;
+
+	for (;;)
+	{
+		barrierWait(w);
+
+		if (NULL == pool.job)
+		{
+			break;
+		}
+
+		pool.job(w);
+		barrierWait(w);
+	}
+
+	return NULL;
+}
+
+/* ************************************************************************ */
+/* runJob: runs job in all workers, the main thread is worker 0            */
+/* ************************************************************************ */
+static
+void
+runJob (void (*job) (struct worker*))
+{
+	pool.job = job;
+	barrierWait(&pool.workers[0]);
+	job(&pool.workers[0]);
+	barrierWait(&pool.workers[0]);
+}
+
+/* ************************************************************************ */
+/* initPool: starts options->number - 1 threads; the N-1 inner lines are    */
+/* distributed on the workers, the first (N-1) % threads get one more       */
+/* ************************************************************************ */
+static
+void
+initPool (struct calculation_arguments* arguments, struct calculation_results* results, struct options* options)
+{
+	int k;
+	int n = arguments->N - 1;
+	int threads = (options->number < 1) ? 1 : options->number;
+	void *p;
+
+	pool.threads = threads;
+	pool.arguments = arguments;
+	pool.results = results;
+	pool.options = options;
+	pool.barrier.threads = threads;
+	pool.barrier.count = threads;
+	pool.barrier.sense = 0;
+	pool.job = NULL;
+
+	if (posix_memalign(&p, GRID_ALIGNMENT, threads * sizeof(struct worker)) != 0)
+	{
+		printf("\n\nSpeicherprobleme!\n");
+		/* exit program */
+		exit(1);
+	}
+	pool.workers = p;
+
+	/* maximum residuum of every worker in its own cache line, two iterations */
+	allocateGrid(&pool.Slots, 2, threads * (GRID_ALIGNMENT / sizeof(double)));
+
+	for (k = 0; k < threads; k++)
+	{
+		struct worker* w = &pool.workers[k];
+
+		w->id = k;
+		w->sense = 0;
+		w->wait = 0;
+		w->first = 1 + k * (n / threads) + ((k < n % threads) ? k : n % threads);
+		w->last = w->first + n / threads + ((k < n % threads) ? 1 : 0) - 1;
+
+		if (k > 0 && pthread_create(&w->thread, NULL, workerMain, w) != 0)
+		{
+			printf("Thread %d kann nicht gestartet werden.\n", k);
+			exit(1);
+		}
+	}
+}
+
+/* ************************************************************************ */
+/* freePool: ends the worker threads                                        */
+/* ************************************************************************ */
+static
+void
+freePool (void)
+{
+	int k;
+
+	pool.job = NULL;
+	barrierWait(&pool.workers[0]);
+
+	for (k = 1; k < pool.threads; k++)
+	{
+		pthread_join(pool.workers[k].thread, NULL);
+	}
+
+	freeGrid(&pool.Slots);
+	free(pool.workers);
+}
+
+/* ************************************************************************ */
+/* initVariables: Initializes some global variables                         */
+/* ************************************************************************ */
+static
+void
+initVariables (struct calculation_arguments* arguments, struct calculation_results* results, struct options* options)
+{
+	char const* temporal = getenv("PARTDIFF_TEMPORAL");
+	char* end;
+
+	arguments->N = options->interlines * 8 + 9 - 1;
+	arguments->num_matrices = (options->method == METH_JACOBI) ? 2 : 1;
+	arguments->h = (float)( ( (float)(1) ) / (arguments->N));
+
+	/* SOR: --omega or the optimal factor of the model problem, 2/(1+sin(pi h)) */
+	arguments->omega = (options->omega > 0) ? options->omega : 2.0 / (1.0 + sin(PI * arguments->h));
+
+	/* Jacobi with temporal blocking: PARTDIFF_TEMPORAL=<iterations per wavefront> */
+	arguments->temporal = 0;
+	if (options->method == METH_JACOBI && NULL != temporal)
+	{
+		arguments->temporal = (int)strtol(temporal, &end, 10);
+		arguments->temporal = (end == temporal) ? TEMPORAL_DEPTH : arguments->temporal;
+		arguments->temporal = (arguments->temporal > TEMPORAL_MAX) ? TEMPORAL_MAX : arguments->temporal;
+		arguments->temporal = (arguments->temporal < 0) ? 0 : arguments->temporal;
+	}
+
+	/* the lines of all iterations of a wavefront in one band fit into the cache */
+	arguments->width = TEMPORAL_CACHE / ((4 * arguments->temporal + 6) * (int)sizeof(double));
+	arguments->width = (arguments->width < 8) ? 8 : arguments->width - arguments->width % 8;
+
+	/* TERM_PREC keeps the start of a wavefront in a third matrix */
+	if (arguments->temporal > 0 && options->termination == TERM_PREC)
+	{
+		arguments->num_matrices = 3;
+	}
+
+	arguments->Func.data = NULL;
+
+	results->m = 0;
+	results->stat_iteration = 0;
+	results->stat_precision = 0;
+	results->stat_overhead = 0;
+}
+
+/* ************************************************************************ */
+/* freeMatrices: frees memory for matrices                                  */
+/* ************************************************************************ */
+static
+void
+freeMatrices (struct calculation_arguments* arguments)
+{
+	int i;
+
+	for (i = 0; i < arguments->num_matrices; i++)
+	{
+		freeGrid(&arguments->Matrix[i]);
+	}
+
+	if (NULL != arguments->Func.data)
+	{
+		freeGrid(&arguments->Func);
+		freeGrid(&arguments->FuncScale);
+	}
+}
+
+/* ************************************************************************ */
+/* allocateMatrices: allocates memory for matrices                          */
+/* ************************************************************************ */
+static
+void
+allocateMatrices (struct calculation_arguments* arguments)
+{
+	int i;
+
+	int N = arguments->N;
+
+	for (i = 0; i < arguments->num_matrices; i++)
+	{
+		allocateGrid(&arguments->Matrix[i], N + 1, N + 1); /* Elementzugriff über Zeilenabstand */
+	}
+}
+
+/* ************************************************************************ */
+/* zeroJob: every worker zeroes its own lines of all matrices, so on a      */
+/* NUMA machine their pages are placed on its socket (first touch)          */
+/* ************************************************************************ */
+static
+void
+zeroJob (struct worker* w)
+{
+	int g, i, j;
+	int N = pool.arguments->N;
+	struct grid* Matrix = pool.arguments->Matrix;
+
+	for (g = 0; g < pool.arguments->num_matrices; g++)
+	{
+		for (i = w->first; i <= w->last; i++)
+		{
+			for (j = 0; j <= N; j++)
+			{
+				GRID(&Matrix[g], i, j) = 0;
+			}
+		}
+
+		if (0 == w->id)
+		{
+			for (j = 0; j <= N; j++)
+			{
+				GRID(&Matrix[g], 0, j) = 0;
+				GRID(&Matrix[g], N, j) = 0;
+			}
+		}
+	}
+}
+
+/* ************************************************************************ */
+/* initMatrices: Initialize matrix/matrices and some global variables       */
+/* ************************************************************************ */
+static
+void
+initMatrices (struct calculation_arguments* arguments, struct options* options)
+{
+	int i, j;                                   /*  local variables for loops   */
+
+	int N = arguments->N;
+	double h = arguments->h;
+	struct grid* Matrix = arguments->Matrix;
+
+	/* initialize matrix/matrices with zeros, by the workers */
+	runJob(zeroJob);
+
+	/* initialize borders, depending on function (function 2: nothing to do) */
+	if (options->inf_func == FUNC_F0)
+	{
+		for(i = 0; i <= N; i++)
+		{
+			for (j = 0; j < arguments->num_matrices; j++)
+			{
+				GRID(&Matrix[j], i, 0) = 1 - (h * i);
+				GRID(&Matrix[j], i, N) = h * i;
+				GRID(&Matrix[j], 0, i) = 1 - (h * i);
+				GRID(&Matrix[j], N, i) = h * i;
+			}
+		}
+
+		for (j = 0; j < arguments->num_matrices; j++)
+		{
+			GRID(&Matrix[j], N, 0) = 0;
+			GRID(&Matrix[j], 0, N) = 0;
+		}
+	}
+}
+/* ************************************************************************ */
+/* initFunction: precomputes the forcing term of FUNC_FPISIN                */
+/* The forcing term of point (i,j) is                                       */
+/*     Func(i,j) * FuncScale(i)     table, for small grids                  */
+/*     Func(0,j) * FuncScale(i)     separable, for large grids              */
+/* ************************************************************************ */
+static
+void
+initFunction (struct calculation_arguments* arguments, struct options* options)
+{
+	int i, j;
+
+	int N = arguments->N;
+	double h = arguments->h;
+	struct grid* Func = &arguments->Func;
+	double* scale;
+
+	if (options->inf_func != FUNC_FPISIN)
+	{
+		return;
+	}
+
+	allocateGrid(&arguments->FuncScale, 1, N + 1);
+	scale = GRID_LINE(&arguments->FuncScale, 0);
+
+	if ((size_t)(N + 1) * gridStride(N + 1) * sizeof(double) <= FUNC_TABLE_MAX)
+	{
+		allocateGrid(Func, N + 1, N + 1);
+
+		for (i = 0; i <= N; i++)
+		{
+			scale[i] = 1.0;
+
+			for (j = 0; j <= N; j++)
+			{
+				GRID(Func, i, j) = TWO_PI_SQUARE * sin((double)(j) * PI * h) * sin((double)(i) * PI * h) * h * h * 0.25;
+			}
+		}
+	}
+	else
+	{
+		allocateGrid(Func, 1, N + 1);
+
+		for (i = 0; i <= N; i++)
+		{
+			scale[i] = sin((double)(i) * PI * h);
+			GRID(Func, 0, i) = TWO_PI_SQUARE * sin((double)(i) * PI * h) * h * h * 0.25;
+		}
+	}
+}
+
+/* ************************************************************************ */
+/* jacobiPoints: calculates the points jfirst..jlast of line i of           */
+/* Matrix[m1] from Matrix[m2], returns their maximum residuum               */
+/* ************************************************************************ */
+static
+double
+jacobiPoints (struct calculation_arguments* arguments, struct options* options, int m1, int m2,
+              int i, int jfirst, int jlast)
+{
+	int o = jfirst - 1;                         /* offset for the line kernel                     */
+	struct grid* Matrix = arguments->Matrix;
+	double const* func = NULL;                  /* forcing term of line i and its line factor     */
+	double scale = 0;
+
+	if (options->inf_func == FUNC_FPISIN)
+	{
+		func = GRID_LINE(&arguments->Func, (arguments->Func.rows > 1) ? i : 0) + o;
+		scale = GRID(&arguments->FuncScale, 0, i);
+	}
+
+	return jacobiLine(GRID_LINE(&Matrix[m1], i) + o, GRID_LINE(&Matrix[m2], i - 1) + o, GRID_LINE(&Matrix[m2], i) + o,
+	                  GRID_LINE(&Matrix[m2], i + 1) + o, func, scale, jlast - jfirst + 2);
+}
+
+/* ************************************************************************ */
+/* jacobiWavefront: performs "depth" Jacobi iterations starting from        */
+/* Matrix[src] with temporal blocking, see partdiff-seq.c. Iteration t      */
+/* writes Matrix[a] if t is even and Matrix[b] if t is odd; src may be b.   */
+/* The iterations of one step work on different lines: worker k calculates  */
+/* the iterations t with t % threads == k and stores their maximum          */
+/* residuum in pool.residuals[t], the workers meet after every step.        */
+/* Returns the matrix with the last iteration.                              */
+/* ************************************************************************ */
+static
+int
+jacobiWavefront (struct worker* w, int src, int a, int b, int depth)
+{
+	int c0, s, t, i;                            /* first column of the band, step, iteration, line */
+	int N = pool.arguments->N;
+	int width = pool.arguments->width;
+	double residuum;
+
+	for (t = w->id; t < depth; t += pool.threads)
+	{
+		pool.residuals[t] = 0;
+	}
+
+	for (c0 = 1; c0 < N + depth - 1; c0 += width)
+	{
+		for (s = 1; s < N + 2 * (depth - 1); s++)
+		{
+			for (t = w->id; t < depth; t += pool.threads)
+			{
+				i = s - 2 * t;
+
+				if (1 <= i && i < N)
+				{
+					residuum = jacobiPoints(pool.arguments, pool.options, (t % 2 == 0) ? a : b,
+					                        (t == 0) ? src : ((t % 2 == 1) ? a : b), i,
+					                        (c0 - t < 1) ? 1 : c0 - t, (c0 + width - 1 - t > N - 1) ? N - 1 : c0 + width - 1 - t);
+					pool.residuals[t] = (residuum < pool.residuals[t]) ? pool.residuals[t] : residuum;
+				}
+			}
+
+			syncWorkers(w);
+		}
+	}
+
+	return ((depth - 1) % 2 == 0) ? a : b;
+}
+
+/* ************************************************************************ */
+/* temporalJob: Jacobi with temporal blocking, arguments->temporal          */
+/* iterations at a time (see calculateTemporal in partdiff-seq.c). All      */
+/* workers take the same decisions from pool.residuals.                     */
+/* ************************************************************************ */
+static
+void
+temporalJob (struct worker* w)
+{
+	int t, n;
+	int src = 0;                                /* matrix with the current iteration              */
+	int last;                                   /* matrix with the last iteration of a wavefront  */
+	int matrices = pool.arguments->num_matrices;
+	int term_iteration = pool.options->term_iteration;
+	struct options* options = pool.options;
+
+	while (term_iteration > 0)
+	{
+		n = pool.arguments->temporal;
+
+		if (options->termination == TERM_ITER && n > term_iteration)
+		{
+			n = term_iteration;
+		}
+
+		/* TERM_PREC: the two other matrices, TERM_ITER: the other one and src */
+		TRACE_BEGIN(w->id, "wavefront");
+		last = jacobiWavefront(w, src, (src + 1) % matrices, (src + 2) % matrices, n);
+		TRACE_END(w->id);
+
+		if (options->termination == TERM_PREC)
+		{
+			for (t = 0; t < n && pool.residuals[t] >= options->term_precision; t++)
+			{
+				/* first iteration below the precision */
+			}
+
+			if (t < n)
+			{
+				if (t + 1 < n)
+				{
+					/* all workers have read the residuals */
+					syncWorkers(w);
+					last = jacobiWavefront(w, src, (src + 1) % 3, (src + 2) % 3, t + 1);
+				}
+
+				n = t + 1;
+				term_iteration = 0;
+			}
+		}
+		else if (options->termination == TERM_ITER)
+		{
+			term_iteration -= n;
+		}
+
+		if (0 == w->id)
+		{
+			pool.results->stat_iteration += n;
+			pool.results->stat_precision = pool.residuals[n - 1];
+		}
+
+		src = last;
+
+		/* the residuals are read before the next wavefront resets them */
+		syncWorkers(w);
+	}
+
+	if (0 == w->id)
+	{
+		options->term_iteration = term_iteration;
+		pool.results->m = src;
+	}
+}
+
+/* ************************************************************************ */
+/* calculateLine: calculates line i of Matrix[m1] from Matrix[m2] (Jacobi)  */
+/* or in place (Gauss-Seidel, one color of red-black), returns its maximum  */
+/* residuum                                                                 */
+/* ************************************************************************ */
+static
+double
+calculateLine (struct calculation_arguments* arguments, struct options* options, int m1, int m2, int i, int color)
+{
+	int N = arguments->N;
+	struct grid* Matrix = arguments->Matrix;
+	double* out = GRID_LINE(&Matrix[m1], i);    /* line i of the new matrix                       */
+	double const* up = GRID_LINE(&Matrix[m2], i - 1);  /* lines i-1, i and i+1 of the old matrix */
+	double const* mid = GRID_LINE(&Matrix[m2], i);
+	double const* down = GRID_LINE(&Matrix[m2], i + 1);
+	double const* func = NULL;                  /* forcing term of line i and its line factor     */
+	double scale = 0;
+
+	if (options->inf_func == FUNC_FPISIN)
+	{
+		func = GRID_LINE(&arguments->Func, (arguments->Func.rows > 1) ? i : 0);
+		scale = GRID(&arguments->FuncScale, 0, i);
+	}
+
+	if (options->method == METH_JACOBI)
+	{
+		/* vectorized line kernel (stencil.c) */
+		return jacobiLine(out, up, mid, down, func, scale, N);
+	}
+	else if (options->method == METH_RED_BLACK)
+	{
+		/* only the points with (i + j) % 2 == color */
+		return gaussSeidelLine(out, up, down, func, scale, N, 1 + (i + 1 + color) % 2, 2);
+	}
+	else if (options->method == METH_SOR)
+	{
+		/* red-black, over-relaxed by omega */
+		return sorLine(out, up, down, func, scale, arguments->omega, N, 1 + (i + 1 + color) % 2, 2);
+	}
+
+	/* Gauss-Seidel: mid[j-1] was just calculated, so go point by point */
+	return gaussSeidelLine(out, up, down, func, scale, N, 1, 1);
+}
+
+/* ************************************************************************ */
+/* calculateJob: the iterations of one worker on its own lines. The         */
+/* workers meet at the barrier after each sweep (each color). Every worker  */
+/* leaves its maximum residuum in its own cache line of pool.Slots, line    */
+/* iteration % 2, so the slots of the next iteration can be written while   */
+/* slow workers still read these; no mutex is needed. All workers take the  */
+/* termination decision from the same slots, worker 0 updates results.      */
+/* Lexicographic Gauss-Seidel needs line i-1 of this iteration, so worker 0 */
+/* calculates all lines.                                                    */
+/* ************************************************************************ */
+static
+void
+calculateJob (struct worker* w)
+{
+	int i, k;                                   /* local variables for loops                      */
+	int m1, m2;                                 /* used as indices for old and new matrices       */
+	int color, colors;                          /* half sweeps per iteration (red-black: 2)       */
+	int iteration;
+	int per_line = GRID_ALIGNMENT / sizeof(double);  /* one slot per cache line              */
+	int first = w->first;                       /* own lines                                      */
+	int last = w->last;
+	struct calculation_arguments* arguments = pool.arguments;
+	struct options* options = pool.options;
+	int term_iteration = options->term_iteration;  /* same in every worker                  */
+	int due;                                    /* the residuum of this iteration is merged       */
+	struct residual schedule = residual;        /* the same decisions in every worker             */
+	struct timespec start, end;
+	double residuum;                            /* residuum of current line                       */
+	double t_maxresiduum;                       /* maximum residuum of this worker                */
+	double maxresiduum = 0;                     /* maximum residuum of all workers                */
+
+	/* initialize m1 and m2 depending on algorithm */
+	if (options->method == METH_JACOBI)
+	{
+		m1=0; m2=1;
+	}
+	else
+	{
+		m1=0; m2=0;
+	}
+
+	if (options->method == METH_GAUSS_SEIDEL)
+	{
+		first = 1;
+		last = (0 == w->id) ? arguments->N - 1 : 0;
+	}
+
+	colors = (options->method == METH_RED_BLACK || options->method == METH_SOR) ? 2 : 1;
+
+	for (iteration = 0; term_iteration > 0; iteration++)
+	{
+		due = residualDue(&schedule, iteration + 1, term_iteration == 1);
+		t_maxresiduum = 0;
+
+		/* red-black: all red points (i + j even) first, then all black points; */
+		/* the lines of one color can be calculated in parallel                 */
+		for (color = 0; color < colors; color++)
+		{
+			TRACE_BEGIN(w->id, "sweep");
+			for (i = first; i <= last; i++)
+			{
+				residuum = calculateLine(arguments, options, m1, m2, i, color);
+				t_maxresiduum = (residuum < t_maxresiduum) ? t_maxresiduum : residuum;
+			}
+
+			if (due)
+			{
+				GRID(&pool.Slots, iteration % 2, w->id * per_line) = t_maxresiduum;
+			}
+			TRACE_END(w->id);
+
+			/* the sweep (color) is complete in all workers */
+			syncWorkers(w);
+		}
+
+		if (due)
+		{
+			TRACE_BEGIN(w->id, "merge");
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			maxresiduum = 0;
+			for (k = 0; k < pool.threads; k++)
+			{
+				maxresiduum = (GRID(&pool.Slots, iteration % 2, k * per_line) < maxresiduum) ? maxresiduum : GRID(&pool.Slots, iteration % 2, k * per_line);
+			}
+			residualUpdate(&schedule, iteration + 1, maxresiduum, options->term_precision);
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			schedule.time += (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+			TRACE_END(w->id);
+		}
+
+		/* exchange m1 and m2 */
+		i=m1; m1=m2; m2=i;
+
+		/* check for stopping calculation, depending on termination method */
+		TRACE_BEGIN(w->id, "termination");
+		if (options->termination == TERM_PREC)
+		{
+			if (due && maxresiduum < options->term_precision)
+			{
+				term_iteration = 0;
+			}
+		}
+		else if (options->termination == TERM_ITER)
+		{
+			term_iteration--;
+		}
+		TRACE_END(w->id);
+
+		if (0 == w->id)
+		{
+			pool.results->stat_iteration++;
+
+			if (due)
+			{
+				pool.results->stat_precision = maxresiduum;
+			}
+		}
+	}
+
+	if (0 == w->id)
+	{
+		options->term_iteration = term_iteration;
+		pool.results->m = m2;
+		residual = schedule;
+	}
+}
+
+/* ************************************************************************ */
+/* calculate: solves the equation with the workers of the pool              */
+/* ************************************************************************ */
+static
+void
+calculate (struct calculation_arguments* arguments, struct calculation_results *results)
+{
+	int k;
+
+	for (k = 0; k < pool.threads; k++)
+	{
+		pool.workers[k].wait = 0;
+	}
+
+	/* Jacobi: several iterations per pass over the matrix */
+	runJob((arguments->temporal > 0) ? temporalJob : calculateJob);
+
+	for (k = 0; k < pool.threads; k++)
+	{
+		results->stat_overhead += pool.workers[k].wait / pool.threads;
+	}
+}
+
+/* ************************************************************************ */
+/* trafficModel: bytes from and to memory per point and iteration for the   */
+/* roofline report, compulsory traffic without write allocate as in         */
+/* benchmark.sh: every pass reads and writes each matrix value once and     */
+/* reads the forcing term table (the separable form stays in the cache).    */
+/* Describes the layout in model; 0: no model for the method                */
+/* ************************************************************************ */
+static
+double
+trafficModel (struct calculation_arguments* arguments, struct options* options, char* model, size_t size)
+{
+	int passes = (options->method == METH_RED_BLACK || options->method == METH_SOR) ? 2 : 1;
+	int table = (options->inf_func == FUNC_FPISIN && arguments->Func.rows > 1);
+	char const* matrix = (options->method == METH_JACOBI) ? "2 Matrizen" : "1 Matrix";
+	double bytes = 16.0 * passes + ((table) ? 8.0 * passes : 0);
+
+	/* temporal blocking: one pass over the matrix per wavefront */
+	if (arguments->temporal > 0)
+	{
+		bytes /= arguments->temporal;
+	}
+
+	snprintf(model, size, "%.1f Byte pro Punkt (%s, Stoerfunktion %s)", bytes, matrix,
+	         (options->inf_func == FUNC_F0) ? "keine" : (table) ? "Tabelle" : "separabel");
+
+	return bytes;
+}
+
+/* ************************************************************************ */
+/*  displayStatistics: displays some statistics about the calculation       */
+/* ************************************************************************ */
+static
+void
+displayStatistics (struct calculation_arguments* arguments, struct calculation_results *results, struct options* options)
+{
+	int N = arguments->N;
+
+	double time = (comp_time.tv_sec - start_time.tv_sec) + (comp_time.tv_usec - start_time.tv_usec) * 1e-6;
+	printf("Berechnungszeit:    %f s \n", time);
+
+	//Calculate Flops
+	// star op = 5 ASM ops (+1 XOR) with -O3, matrix korrektur = 1
+	double q = 6;
+	double q_func = 0;
+	double mflops;
+
+	// residuum: checked 1 flop in ASM, verified on Nehalem architecture.
+	q += 1.0;
+
+	if (options->method == METH_SOR)
+	{
+		// over-relaxation: one multiplication with omega and one addition
+		q += 2.0;
+	}
+
+	if (options->inf_func == FUNC_FPISIN)
+	{
+		// forcing term: precomputed, one multiplication with the line factor and one addition
+		q_func = 2.0;
+	}
+
+	/* calculate flops, with and without the forcing term */
+	mflops = ((q + q_func) * (N - 1) * (N - 1) * results->stat_iteration) * 1e-6;
+	printf("Executed float ops: %f MFlop\n", mflops);
+	printf("Speed:              %f MFlop/s\n", mflops / time);
+	printf("Speed ohne Stoerf.: %f MFlop/s\n", (q * (N - 1) * (N - 1) * results->stat_iteration) * 1e-6 / time);
+
+	if (counters != NULL)
+	{
+		counterReport(counters, pool.threads, "Thread", mflops, time);
+	}
+
+	if (roofline != NULL)
+	{
+		char model[160];
+		double bytes = trafficModel(arguments, options, model, sizeof(model));
+
+		rooflineReport(roofline, pool.threads, "Threads", mflops, bytes * (N - 1) * (N - 1) * results->stat_iteration * 1e-6, time, model);
+	}
+
+	printf("Berechnungsmethode: ");
+
+	if (options->method == METH_GAUSS_SEIDEL)
+	{
+		printf("Gauss-Seidel");
+	}
+	else if (options->method == METH_JACOBI)
+	{
+		printf("Jacobi");
+	}
+	else if (options->method == METH_RED_BLACK)
+	{
+		printf("Gauss-Seidel (Rot-Schwarz)");
+	}
+	else if (options->method == METH_SOR)
+	{
+		printf("SOR (Rot-Schwarz)");
+	}
+
+	printf("\n");
+	printf("Rechenkern:         %s\n", stencilName());
+	printf("Anzahl Threads:     %d (pthreads)\n", pool.threads);
+
+	if (results->stat_iteration > 0)
+	{
+		printf("Synchronisation:    %f us pro Iteration\n", results->stat_overhead * 1e6 / results->stat_iteration);
+	}
+
+	if (options->method == METH_SOR)
+	{
+		printf("Relaxation:         omega = %f (%s)\n", arguments->omega, (options->omega > 0) ? "--omega" : "2/(1+sin(pi h))");
+	}
+
+	if (arguments->temporal > 0)
+	{
+		printf("Zeitblockung:       %d Iterationen, Baender von %d Spalten\n", arguments->temporal, arguments->width);
+	}
+
+	residualReport(&residual, results->stat_iteration);
+
+	printf("Interlines:         %d\n",options->interlines);
+	printf("Stoerfunktion:      ");
+
+	if (options->inf_func == FUNC_F0)
+	{
+		printf("f(x,y)=0");
+	}
+	else if (options->inf_func == FUNC_FPISIN)
+	{
+		printf("f(x,y)=2pi^2*sin(pi*x)sin(pi*y)");
+	}
+
+	printf("\n");
+	printf("Terminierung:       ");
+
+	if (options->termination == TERM_PREC)
+	{
+		printf("Hinreichende Genaugkeit");
+	}
+	else if (options->termination == TERM_ITER)
+	{
+		printf("Anzahl der Iterationen");
+	}
+
+	printf("\n");
+	printf("Anzahl Iterationen: %d\n", results->stat_iteration);
+	printf("Norm des Fehlers:   %e\n", results->stat_precision);
+}
+
+/* ************************************************************************ */
+/* counterStartJob, counterStopJob: every worker counts itself              */
+/* ************************************************************************ */
+static
+void
+counterStartJob (struct worker* w)
+{
+	counterStart(&counters[w->id]);
+}
+
+static
+void
+counterStopJob (struct worker* w)
+{
+	counterStop(&counters[w->id]);
+}
+
+/* ************************************************************************ */
+/* rooflineJob: every worker probes its share of the triad arrays           */
+/* ************************************************************************ */
+static
+void
+rooflineJob (struct worker* w)
+{
+	rooflineProbe(&roofline[w->id], ROOFLINE_ELEMENTS / pool.threads);
+}
+
+/* ************************************************************************ */
+/*  main                                                                    */
+/* ************************************************************************ */
+int
+main (int argc, char** argv)
+{
+	struct options options;
+	struct calculation_arguments arguments;
+	struct calculation_results results;
+
+	/* get parameters */
+	AskParams(&options, argc, argv);              /* ************************* */
+	initStencil();                                /*  select line kernel       */
+
+	if (options.method == METH_MULTIGRID || options.method == METH_CG)
+	{
+		printf("Mehrgitterverfahren und CG nur in partdiff-seq und partdiff-openmp.\n");
+		exit(1);
+	}
+
+	if (options.mixed)
+	{
+		printf("--precision=mixed nur in partdiff-seq und partdiff-openmp.\n");
+		exit(1);
+	}
+
+	initVariables(&arguments, &results, &options);           /* ******************************************* */
+	initPool(&arguments, &results, &options);                /*  start the worker threads                   */
+
+	allocateMatrices(&arguments);        /*  get and initialize variables and matrices  */
+	initMatrices(&arguments, &options);            /* ******************************************* */
+	initFunction(&arguments, &options);            /*  precompute forcing term                    */
+
+	if (options.roofline)
+	{
+		roofline = malloc(pool.threads * sizeof(struct roofline));
+		runJob(rooflineJob);
+	}
+
+	if (counterEnabled())
+	{
+		counters = malloc(pool.threads * sizeof(struct counters));
+	}
+
+	/* PARTDIFF_TRACE=<file>: events of calculate(), one buffer per worker */
+	if (traceWanted())
+	{
+		traceInit(pool.threads, 0);
+	}
+
+	residualInit(&residual, options.adaptive, options.termination == TERM_PREC, options.method != METH_SOR);
+
+	gettimeofday(&start_time, NULL);                   /*  start timer         */
+
+	if (counters != NULL)
+	{
+		runJob(counterStartJob);
+	}
+
+	calculate(&arguments, &results);                   /*  solve the equation  */
+
+	if (counters != NULL)
+	{
+		runJob(counterStopJob);
+	}
+
+	gettimeofday(&comp_time, NULL);                   /*  stop timer          */
+
+	displayStatistics(&arguments, &results, &options);                                  /* **************** */
+	DisplayMatrix("Matrix:",                              /*  display some    */
+			&arguments.Matrix[results.m], options.interlines);            /*  statistics and  */
+
+	freePool();
+	freeMatrices(&arguments);                                       /*  free memory     */
+	free(counters);
+	free(roofline);
+	traceFinish();
+
+	return 0;
+}
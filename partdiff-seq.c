@@ -18,22 +18,40 @@
 /* ************************************************************************ */
 /* Include standard header file.                                            */
 /* ************************************************************************ */
-#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
 #include <malloc.h>
 #include <sys/time.h>
 #include "partdiff-seq.h"
+#include "stencil.h"
+#include "counters.h"
+#include "roofline.h"
+#include "trace.h"
+#include "residual.h"
 
 
+struct level
+{
+	int     N;              /* number of spaces between lines                 */
+	struct grid U;          /* approximation (finest grid) or correction      */
+	struct grid V;          /* Jacobi smoother: new values; residual          */
+	struct grid B;          /* right hand side (finest grid: Func)            */
+};
+
 struct calculation_arguments
 {
 	int     N;              /* number of spaces between lines (lines=N+1)     */
 	int     num_matrices;   /* number of matrices                             */
-	double  ***Matrix;      /* index matrix used for addressing M             */
-	double  *M;             /* two matrices with real values                  */
+	struct grid Matrix[4];  /* matrices with real values (Jacobi: 2 or 3, CG: 4) */
+	struct grid Func;       /* forcing term without line factor (initFunction) */
+	struct grid FuncScale;  /* line factors of the forcing term               */
 	double  h;              /* length of a space between two lines            */
+	double  omega;          /* SOR: relaxation factor                         */
+	int     temporal;       /* Jacobi: iterations per wavefront, 0: sweeps    */
+	int     width;          /* columns per band of a wavefront                */
+	int     levels;         /* multigrid: number of grids                     */
+	struct level* Level;    /* multigrid: grids from fine to coarse           */
 };
 
 struct calculation_results
@@ -41,6 +59,9 @@ struct calculation_results
 	int     m;
 	int     stat_iteration; /* number of current iteration                    */
 	double  stat_precision; /* actual precision of all slaves in iteration    */
+	int     stat_float_iteration; /* mixed precision: iterations in float     */
+	int     stat_refinements; /* mixed precision: residuals in double         */
+	double  stat_float_time; /* mixed precision: seconds in float            */
 };
 
 /* ************************************************************************ */
@@ -51,6 +72,14 @@ struct calculation_results
 struct timeval start_time;       /* time when program started                      */
 struct timeval comp_time;        /* time when calculation completed                */
 
+/* hardware counters around calculate(), NULL if not wanted (PARTDIFF_COUNTERS) */
+struct counters* counters = NULL;
+
+/* bandwidth and peak probes, NULL without --roofline */
+struct roofline* roofline = NULL;
+
+/* evaluations of the residuum (--residual=adaptive) */
+struct residual residual;
 
 /* ************************************************************************ */
 /* initVariables: Initializes some global variables                         */
@@ -59,13 +88,61 @@ static
 void
 initVariables (struct calculation_arguments* arguments, struct calculation_results* results, struct options* options)
 {
+	char const* temporal = getenv("PARTDIFF_TEMPORAL");
+	char* end;
+	int n;
+
 	arguments->N = options->interlines * 8 + 9 - 1;
-	arguments->num_matrices = (options->method == METH_JACOBI) ? 2 : 1;
+	arguments->num_matrices = (options->method == METH_JACOBI || options->method == METH_MULTIGRID) ? 2 : 1;
 	arguments->h = (float)( ( (float)(1) ) / (arguments->N));
 
+	/* SOR: --omega or the optimal factor of the model problem, 2/(1+sin(pi h)) */
+	arguments->omega = (options->omega > 0) ? options->omega : 2.0 / (1.0 + sin(PI * arguments->h));
+
+	/* Jacobi with temporal blocking: PARTDIFF_TEMPORAL=<iterations per wavefront> */
+	arguments->temporal = 0;
+	if (options->method == METH_JACOBI && NULL != temporal)
+	{
+		arguments->temporal = (int)strtol(temporal, &end, 10);
+		arguments->temporal = (end == temporal) ? TEMPORAL_DEPTH : arguments->temporal;
+		arguments->temporal = (arguments->temporal > TEMPORAL_MAX) ? TEMPORAL_MAX : arguments->temporal;
+		arguments->temporal = (arguments->temporal < 0) ? 0 : arguments->temporal;
+	}
+
+	/* the lines of all iterations of a wavefront in one band fit into the cache */
+	arguments->width = TEMPORAL_CACHE / ((4 * arguments->temporal + 6) * (int)sizeof(double));
+	arguments->width = (arguments->width < 8) ? 8 : arguments->width - arguments->width % 8;
+
+	/* TERM_PREC keeps the start of a wavefront in a third matrix */
+	if (arguments->temporal > 0 && options->termination == TERM_PREC)
+	{
+		arguments->num_matrices = 3;
+	}
+
+	/* multigrid: halve the spaces down to MG_COARSEST (rounded up if odd) */
+	arguments->levels = 0;
+	if (options->method == METH_MULTIGRID)
+	{
+		for (n = arguments->N, arguments->levels = 1; n > MG_COARSEST; n = (n + 1) / 2)
+		{
+			arguments->levels++;
+		}
+	}
+
+	/* CG: approximation, residual, direction and its product with A */
+	if (options->method == METH_CG)
+	{
+		arguments->num_matrices = 4;
+	}
+
+	arguments->Func.data = NULL;
+
 	results->m = 0;
 	results->stat_iteration = 0;
 	results->stat_precision = 0;
+	results->stat_float_iteration = 0;
+	results->stat_refinements = 0;
+	results->stat_float_time = 0;
 }
 
 /* ************************************************************************ */
@@ -77,139 +154,885 @@ freeMatrices (struct calculation_arguments* arguments)
 {
 	int i;
 
-	for (i = 0; i < arguments->num_matrices; i++)
+	for (i = 0; i < arguments->num_matrices; i++)
+	{
+		freeGrid(&arguments->Matrix[i]);
+	}
+
+	if (NULL != arguments->Func.data)
+	{
+		freeGrid(&arguments->Func);
+		freeGrid(&arguments->FuncScale);
+	}
+
+	/* the finest grid is Matrix[0] and Matrix[1] */
+	for (i = 1; i < arguments->levels; i++)
+	{
+		freeGrid(&arguments->Level[i].U);
+		freeGrid(&arguments->Level[i].V);
+		freeGrid(&arguments->Level[i].B);
+	}
+
+	if (arguments->levels > 0)
+	{
+		free(arguments->Level);
+	}
+}
+
+/* ************************************************************************ */
+/* allocateMatrices: allocates memory for matrices                          */
+/* ************************************************************************ */
+static
+void
+allocateMatrices (struct calculation_arguments* arguments)
+{
+	int i;
+
+	int N = arguments->N;
+
+	for (i = 0; i < arguments->num_matrices; i++)
+	{
+		allocateGrid(&arguments->Matrix[i], N + 1, N + 1); /* Elementzugriff über Zeilenabstand */
+	}
+
+	if (arguments->levels > 0)
+	{
+		arguments->Level = malloc(arguments->levels * sizeof(struct level));
+
+		if (NULL == arguments->Level)
+		{
+			printf("\n\nSpeicherprobleme!\n");
+			/* exit program */
+			exit(1);
+		}
+
+		arguments->Level[0].N = N;
+		arguments->Level[0].U = arguments->Matrix[0];
+		arguments->Level[0].V = arguments->Matrix[1];
+		arguments->Level[0].B.data = NULL;
+
+		for (i = 1; i < arguments->levels; i++)
+		{
+			N = arguments->Level[i].N = (arguments->Level[i - 1].N + 1) / 2;
+			allocateGrid(&arguments->Level[i].U, N + 1, N + 1);
+			allocateGrid(&arguments->Level[i].V, N + 1, N + 1);
+			allocateGrid(&arguments->Level[i].B, N + 1, N + 1);
+		}
+	}
+}
+
+/* ************************************************************************ */
+/* initMatrices: Initialize matrix/matrices and some global variables       */
+/* ************************************************************************ */
+static
+void
+initMatrices (struct calculation_arguments* arguments, struct options* options)
+{
+	int g, i, j;                                /*  local variables for loops   */
+
+	int N = arguments->N;
+	double h = arguments->h;
+	struct grid* Matrix = arguments->Matrix;
+
+	/* initialize matrix/matrices with zeros */
+	for (g = 0; g < arguments->num_matrices; g++)
+	{
+		for (i = 0; i <= N; i++)
+		{
+			for (j = 0; j <= N; j++)
+			{
+				GRID(&Matrix[g], i, j) = 0;
+			}
+		}
+	}
+
+	/* initialize borders, depending on function (function 2: nothing to do) */
+	if (options->inf_func == FUNC_F0)
+	{
+		for(i = 0; i <= N; i++)
+		{
+			for (j = 0; j < arguments->num_matrices; j++)
+			{
+				GRID(&Matrix[j], i, 0) = 1 - (h * i);
+				GRID(&Matrix[j], i, N) = h * i;
+				GRID(&Matrix[j], 0, i) = 1 - (h * i);
+				GRID(&Matrix[j], N, i) = h * i;
+			}
+		}
+
+		for (j = 0; j < arguments->num_matrices; j++)
+		{
+			GRID(&Matrix[j], N, 0) = 0;
+			GRID(&Matrix[j], 0, N) = 0;
+		}
+	}
+}
+/* ************************************************************************ */
+/* initFunction: precomputes the forcing term of FUNC_FPISIN                */
+/* The forcing term of point (i,j) is                                       */
+/*     Func(i,j) * FuncScale(i)     table, for small grids                  */
+/*     Func(0,j) * FuncScale(i)     separable, for large grids              */
+/* so calculate() no longer calls sin() for every point and iteration. The  */
+/* table reproduces the former per-point expression exactly; the separable  */
+/* form needs only two vectors but may differ in the last bit.              */
+/* ************************************************************************ */
+static
+void
+initFunction (struct calculation_arguments* arguments, struct options* options)
+{
+	int i, j;
+
+	int N = arguments->N;
+	double h = arguments->h;
+	struct grid* Func = &arguments->Func;
+	double* scale;
+
+	if (options->inf_func != FUNC_FPISIN)
+	{
+		return;
+	}
+
+	allocateGrid(&arguments->FuncScale, 1, N + 1);
+	scale = GRID_LINE(&arguments->FuncScale, 0);
+
+	if ((size_t)(N + 1) * gridStride(N + 1) * sizeof(double) <= FUNC_TABLE_MAX)
+	{
+		allocateGrid(Func, N + 1, N + 1);
+
+		for (i = 0; i <= N; i++)
+		{
+			scale[i] = 1.0;
+
+			for (j = 0; j <= N; j++)
+			{
+				GRID(Func, i, j) = TWO_PI_SQUARE * sin((double)(j) * PI * h) * sin((double)(i) * PI * h) * h * h * 0.25;
+			}
+		}
+	}
+	else
+	{
+		allocateGrid(Func, 1, N + 1);
+
+		for (i = 0; i <= N; i++)
+		{
+			scale[i] = sin((double)(i) * PI * h);
+			GRID(Func, 0, i) = TWO_PI_SQUARE * sin((double)(i) * PI * h) * h * h * 0.25;
+		}
+	}
+}
+
+/* ************************************************************************ */
+/* jacobiPoints: calculates the points jfirst..jlast of line i of           */
+/* Matrix[m1] from Matrix[m2], returns their maximum residuum               */
+/* ************************************************************************ */
+static
+double
+jacobiPoints (struct calculation_arguments* arguments, struct options* options, int m1, int m2,
+              int i, int jfirst, int jlast)
+{
+	int o = jfirst - 1;                         /* offset for the line kernel                     */
+	struct grid* Matrix = arguments->Matrix;
+	double const* func = NULL;                  /* forcing term of line i and its line factor     */
+	double scale = 0;
+
+	if (options->inf_func == FUNC_FPISIN)
+	{
+		func = GRID_LINE(&arguments->Func, (arguments->Func.rows > 1) ? i : 0) + o;
+		scale = GRID(&arguments->FuncScale, 0, i);
+	}
+
+	return jacobiLine(GRID_LINE(&Matrix[m1], i) + o, GRID_LINE(&Matrix[m2], i - 1) + o, GRID_LINE(&Matrix[m2], i) + o,
+	                  GRID_LINE(&Matrix[m2], i + 1) + o, func, scale, jlast - jfirst + 2);
+}
+
+/* ************************************************************************ */
+/* jacobiWavefront: performs "depth" Jacobi iterations starting from        */
+/* Matrix[src] with temporal blocking. Iteration t writes Matrix[a] if t   */
+/* is even and Matrix[b] if t is odd; src may be b.                         */
+/* The columns are cut into bands of "width" columns. In every band the     */
+/* iterations run as a wavefront over the lines: in step s iteration t      */
+/* calculates line s - 2t, shifted left by t columns. So iteration t-1 has  */
+/* finished lines i-1..i+1 before iteration t calculates line i, and line i */
+/* of iteration t-2 (same matrix) is no longer needed when it is            */
+/* overwritten. All lines of a band stay in the cache for all "depth"       */
+/* iterations instead of being loaded from memory once per iteration.       */
+/* The results are exactly those of "depth" single sweeps. The maximum     */
+/* residuum of every iteration is stored in residuals, the matrix with the  */
+/* last iteration is returned.                                              */
+/* ************************************************************************ */
+static
+int
+jacobiWavefront (struct calculation_arguments* arguments, struct options* options,
+                 int src, int a, int b, int depth, double* residuals)
+{
+	int c0, s, t, i;                            /* first column of the band, step, iteration, line */
+	int N = arguments->N;
+	int width = arguments->width;
+	double residuum;
+
+	for (t = 0; t < depth; t++)
+	{
+		residuals[t] = 0;
+	}
+
+	for (c0 = 1; c0 < N + depth - 1; c0 += width)
+	{
+		for (s = 1; s < N + 2 * (depth - 1); s++)
+		{
+			for (t = 0; t < depth; t++)
+			{
+				i = s - 2 * t;
+
+				if (1 <= i && i < N)
+				{
+					residuum = jacobiPoints(arguments, options, (t % 2 == 0) ? a : b,
+					                        (t == 0) ? src : ((t % 2 == 1) ? a : b), i,
+					                        (c0 - t < 1) ? 1 : c0 - t, (c0 + width - 1 - t > N - 1) ? N - 1 : c0 + width - 1 - t);
+					residuals[t] = (residuum < residuals[t]) ? residuals[t] : residuum;
+				}
+			}
+		}
+	}
+
+	return ((depth - 1) % 2 == 0) ? a : b;
+}
+
+/* ************************************************************************ */
+/* calculateTemporal: solves the equation with the Jacobi method and        */
+/* temporal blocking (jacobiWavefront), arguments->temporal iterations at a */
+/* time. With TERM_PREC the wavefront starts from a matrix it does not      */
+/* change; if the precision was reached before its last iteration, the      */
+/* iterations up to the first one below the precision are repeated, so      */
+/* stat_iteration and stat_precision are those of the sweeps.               */
+/* ************************************************************************ */
+static
+void
+calculateTemporal (struct calculation_arguments* arguments, struct calculation_results *results, struct options* options)
+{
+	int t, n;
+	int src = 0;                                /* matrix with the current iteration              */
+	int last;                                   /* matrix with the last iteration of a wavefront  */
+	double residuals[TEMPORAL_MAX];             /* maximum residuum of every iteration            */
+
+	while (options->term_iteration > 0)
+	{
+		n = arguments->temporal;
+
+		if (options->termination == TERM_ITER && n > options->term_iteration)
+		{
+			n = options->term_iteration;
+		}
+
+		/* TERM_PREC: the two other matrices, TERM_ITER: the other one and src */
+		TRACE_BEGIN(0, "wavefront");
+		last = jacobiWavefront(arguments, options, src, (src + 1) % arguments->num_matrices,
+		                       (src + 2) % arguments->num_matrices, n, residuals);
+		TRACE_END(0);
+
+		if (options->termination == TERM_PREC)
+		{
+			for (t = 0; t < n && residuals[t] >= options->term_precision; t++)
+			{
+				/* first iteration below the precision */
+			}
+
+			if (t < n)
+			{
+				if (t + 1 < n)
+				{
+					last = jacobiWavefront(arguments, options, src, (src + 1) % 3, (src + 2) % 3, t + 1, residuals);
+				}
+
+				n = t + 1;
+				options->term_iteration = 0;
+			}
+		}
+		else if (options->termination == TERM_ITER)
+		{
+			options->term_iteration -= n;
+		}
+
+		results->stat_iteration += n;
+		results->stat_precision = residuals[n - 1];
+		src = last;
+	}
+
+	results->m = src;
+}
+
+/* ************************************************************************ */
+/* levelFunc: right hand side of line i of grid l for the line kernels:     */
+/* the forcing term on the finest grid, the restricted residual below      */
+/* ************************************************************************ */
+static
+double const*
+levelFunc (struct calculation_arguments* arguments, struct options* options, int l, int i, double* scale)
+{
+	if (l > 0)
+	{
+		*scale = 0.25;
+		return GRID_LINE(&arguments->Level[l].B, i);
+	}
+
+	*scale = 0;
+
+	if (options->inf_func == FUNC_FPISIN)
+	{
+		*scale = GRID(&arguments->FuncScale, 0, i);
+		return GRID_LINE(&arguments->Func, (arguments->Func.rows > 1) ? i : 0);
+	}
+
+	return NULL;
+}
+
+/* ************************************************************************ */
+/* smoothLevel: "sweeps" iterations of the given method on grid l with the  */
+/* line kernels of the other methods; Jacobi is damped with MG_OMEGA       */
+/* ************************************************************************ */
+static
+void
+smoothLevel (struct calculation_arguments* arguments, struct options* options, int l, int method, int sweeps)
+{
+	int s, i, j, color;
+	struct level* L = &arguments->Level[l];
+	int N = L->N;
+	int colors = (method == METH_RED_BLACK) ? 2 : 1;
+	double const* func;
+	double scale;
+
+	for (s = 0; s < sweeps; s++)
+	{
+		if (method == METH_JACOBI)
+		{
+			for (i = 1; i < N; i++)
+			{
+				func = levelFunc(arguments, options, l, i, &scale);
+				jacobiLine(GRID_LINE(&L->V, i), GRID_LINE(&L->U, i - 1), GRID_LINE(&L->U, i),
+				           GRID_LINE(&L->U, i + 1), func, scale, N);
+			}
+
+			for (i = 1; i < N; i++)
+			{
+				for (j = 1; j < N; j++)
+				{
+					GRID(&L->U, i, j) += MG_OMEGA * (GRID(&L->V, i, j) - GRID(&L->U, i, j));
+				}
+			}
+		}
+		else
+		{
+			/* red-black: first 1 + (i + 1 + color) % 2, step 2; Gauss-Seidel: 1, 1 */
+			for (color = 0; color < colors; color++)
+			{
+				for (i = 1; i < N; i++)
+				{
+					func = levelFunc(arguments, options, l, i, &scale);
+					gaussSeidelLine(GRID_LINE(&L->U, i), GRID_LINE(&L->U, i - 1), GRID_LINE(&L->U, i + 1),
+					                func, scale, N, (colors == 2) ? 1 + (i + 1 + color) % 2 : 1, colors);
+				}
+			}
+		}
+	}
+}
+
+/* ************************************************************************ */
+/* residualLevel: stores the residual b - Au of grid l in V (A: 4u minus    */
+/* the four neighbours) and returns the maximum of |star - u|, the          */
+/* residuum the other methods report                                        */
+/* ************************************************************************ */
+static
+double
+residualLevel (struct calculation_arguments* arguments, struct options* options, int l)
+{
+	int i, j;
+	struct level* L = &arguments->Level[l];
+	int N = L->N;
+	double const* func;
+	double scale;
+	double* r;
+	double const* u;
+	double residuum;
+	double maxresiduum = 0;
+
+	for (i = 1; i < N; i++)
+	{
+		func = levelFunc(arguments, options, l, i, &scale);
+		r = GRID_LINE(&L->V, i);
+		u = GRID_LINE(&L->U, i);
+
+		residuum = jacobiLine(r, GRID_LINE(&L->U, i - 1), u, GRID_LINE(&L->U, i + 1), func, scale, N);
+		maxresiduum = (residuum < maxresiduum) ? maxresiduum : residuum;
+
+		for (j = 1; j < N; j++)
+		{
+			r[j] = 4 * (r[j] - u[j]);
+		}
+	}
+
+	return maxresiduum;
+}
+
+/* ************************************************************************ */
+/* restrictResidual: right hand side of grid l+1 from the residual of grid  */
+/* l, zero start for its correction. Line i of grid l lies at i * Nc / Nf   */
+/* on grid l+1 (exactly 2I = i if Nf is even); the weights are those of the */
+/* bilinear interpolation, transposed. Because b = h^2 f, the factor        */
+/* (Nc / Nf)^2 of the full weighting cancels against the coarser h.         */
+/* ************************************************************************ */
+static
+void
+restrictResidual (struct calculation_arguments* arguments, int l)
+{
+	int I, J, i, j;
+	struct level* F = &arguments->Level[l];
+	struct level* C = &arguments->Level[l + 1];
+	int Nf = F->N;
+	int Nc = C->N;
+	double wi, wj;
+	double* b;
+	double const* r;
+
+	for (I = 0; I <= Nc; I++)
+	{
+		b = GRID_LINE(&C->B, I);
+
+		for (J = 0; J <= Nc; J++)
+		{
+			GRID(&C->U, I, J) = 0;
+			b[J] = 0;
+		}
+
+		if (0 == I || I == Nc)
+		{
+			continue;
+		}
+
+		/* fine lines with a positive weight: (I-1) Nf < i Nc < (I+1) Nf */
+		for (i = (I - 1) * Nf / Nc + 1; i <= ((I + 1) * Nf - 1) / Nc; i++)
+		{
+			wi = 1.0 - (double)abs(i * Nc - I * Nf) / Nf;
+			r = GRID_LINE(&F->V, i);
+
+			for (J = 1; J < Nc; J++)
+			{
+				for (j = (J - 1) * Nf / Nc + 1; j <= ((J + 1) * Nf - 1) / Nc; j++)
+				{
+					wj = 1.0 - (double)abs(j * Nc - J * Nf) / Nf;
+					b[J] += wi * wj * r[j];
+				}
+			}
+		}
+	}
+}
+
+/* ************************************************************************ */
+/* prolongate: adds the correction of grid l+1, interpolated bilinearly, to */
+/* the inner points of grid l                                               */
+/* ************************************************************************ */
+static
+void
+prolongate (struct calculation_arguments* arguments, int l)
+{
+	int I, J, i, j;
+	struct level* F = &arguments->Level[l];
+	struct level* C = &arguments->Level[l + 1];
+	int Nf = F->N;
+	int Nc = C->N;
+	double wi, wj;
+	double* u;
+	double const* c0;
+	double const* c1;
+
+	for (i = 1; i < Nf; i++)
+	{
+		I = i * Nc / Nf;
+		wi = (double)(i * Nc - I * Nf) / Nf;
+		u = GRID_LINE(&F->U, i);
+		c0 = GRID_LINE(&C->U, I);
+		c1 = GRID_LINE(&C->U, I + 1);
+
+		for (j = 1; j < Nf; j++)
+		{
+			J = j * Nc / Nf;
+			wj = (double)(j * Nc - J * Nf) / Nf;
+			u[j] += (1 - wi) * ((1 - wj) * c0[J] + wj * c0[J + 1]) + wi * ((1 - wj) * c1[J] + wj * c1[J + 1]);
+		}
+	}
+}
+
+/* ************************************************************************ */
+/* cycleLevel: one multigrid cycle on grid l. V-cycle: smooth, correct with */
+/* one cycle on grid l+1, smooth. F-cycle: the correction is an F-cycle     */
+/* followed by a V-cycle. The coarsest grid is solved with MG_COARSE_SWEEPS */
+/* Gauss-Seidel sweeps.                                                     */
+/* ************************************************************************ */
+static
+void
+cycleLevel (struct calculation_arguments* arguments, struct options* options, int l, int cycle)
+{
+	if (l == arguments->levels - 1)
+	{
+		smoothLevel(arguments, options, l, METH_GAUSS_SEIDEL, MG_COARSE_SWEEPS);
+		return;
+	}
+
+	TRACE_BEGIN(0, "smooth");
+	smoothLevel(arguments, options, l, options->smoother, MG_SWEEPS);
+	TRACE_END(0);
+	TRACE_BEGIN(0, "restrict");
+	residualLevel(arguments, options, l);
+	restrictResidual(arguments, l);
+	TRACE_END(0);
+
+	cycleLevel(arguments, options, l + 1, cycle);
+
+	if (cycle == CYCLE_F)
 	{
-		free(arguments->Matrix[i]);
+		cycleLevel(arguments, options, l + 1, CYCLE_V);
 	}
 
-	free(arguments->Matrix);
-	free(arguments->M);
+	TRACE_BEGIN(0, "prolongate");
+	prolongate(arguments, l);
+	TRACE_END(0);
+	TRACE_BEGIN(0, "smooth");
+	smoothLevel(arguments, options, l, options->smoother, MG_SWEEPS);
+	TRACE_END(0);
 }
 
 /* ************************************************************************ */
-/* allocateMemory ()                                                        */
-/* allocates memory and quits if there was a memory allocation problem      */
+/* calculateMultigrid: solves the equation with multigrid cycles on         */
+/* Matrix[0]. One cycle counts as one iteration, its residuum is that of a  */
+/* Jacobi sweep after the cycle.                                            */
 /* ************************************************************************ */
 static
-void*
-allocateMemory (size_t size)
+void
+calculateMultigrid (struct calculation_arguments* arguments, struct calculation_results *results, struct options* options)
 {
-	void *p;
+	double maxresiduum;
 
-	if ((p = malloc(size)) == NULL)
+	while (options->term_iteration > 0)
 	{
-		printf("\n\nSpeicherprobleme!\n");
-		/* exit program */
-		exit(1);
+		TRACE_BEGIN(0, "cycle");
+		cycleLevel(arguments, options, 0, options->cycle);
+		TRACE_END(0);
+		TRACE_BEGIN(0, "residual");
+		maxresiduum = residualLevel(arguments, options, 0);
+		TRACE_END(0);
+
+		results->stat_iteration++;
+		results->stat_precision = maxresiduum;
+
+		/* check for stopping calculation, depending on termination method */
+		if (options->termination == TERM_PREC)
+		{
+			if (maxresiduum < options->term_precision)
+			{
+				options->term_iteration = 0;
+			}
+		}
+		else if (options->termination == TERM_ITER)
+		{
+			options->term_iteration--;
+		}
 	}
 
-	return p;
+	results->m = 0;
 }
 
 /* ************************************************************************ */
-/* allocateMatrices: allocates memory for matrices                          */
+/* calculateCG: solves the equation with the conjugate gradient method,     */
+/* matrix-free: A is 4u minus the four neighbours on the inner points, the  */
+/* right hand side holds the forcing term and the border. Matrix[1..3] are  */
+/* the residual r, the direction p and q = Ap, all with a zero border.      */
+/* The residuum of an iteration is max |r| / 4 = max |star - u|, the one a  */
+/* Jacobi sweep would report at the same approximation.                     */
 /* ************************************************************************ */
 static
 void
-allocateMatrices (struct calculation_arguments* arguments)
+calculateCG (struct calculation_arguments* arguments, struct calculation_results *results, struct options* options)
 {
-	int i, j;
-
+	int g, i, j;
 	int N = arguments->N;
+	struct grid* U = &arguments->Matrix[0];
+	struct grid* R = &arguments->Matrix[1];
+	struct grid* P = &arguments->Matrix[2];
+	struct grid* Q = &arguments->Matrix[3];
+	double const* func = NULL;                  /* forcing term of line i and its line factor     */
+	double scale = 0;
+	double* u;
+	double* r;
+	double* p;
+	double* q;
+	double rr = 0;                              /* (r,r) of the current and the next iteration    */
+	double rr_new;
+	double pq;                                  /* (p,Ap)                                         */
+	double alpha, beta;
+	double maxresiduum;
 
-	arguments->M = allocateMemory(arguments->num_matrices * (N + 1) * (N + 1) * sizeof(double)); 
-	arguments->Matrix = allocateMemory(arguments->num_matrices * sizeof(double**));
+	for (g = 1; g <= 3; g++)
+	{
+		for (i = 0; i <= N; i++)
+		{
+			GRID(&arguments->Matrix[g], 0, i) = 0;
+			GRID(&arguments->Matrix[g], N, i) = 0;
+			GRID(&arguments->Matrix[g], i, 0) = 0;
+			GRID(&arguments->Matrix[g], i, N) = 0;
+		}
+	}
 
-	for (i = 0; i < arguments->num_matrices; i++)
+	/* r = b - Au = 4 (star - u), p = r */
+	for (i = 1; i < N; i++)
 	{
-		arguments->Matrix[i] = allocateMemory((N + 1) * sizeof(double*)); /* Elementzugriff über Zeiger */
+		if (options->inf_func == FUNC_FPISIN)
+		{
+			func = GRID_LINE(&arguments->Func, (arguments->Func.rows > 1) ? i : 0);
+			scale = GRID(&arguments->FuncScale, 0, i);
+		}
 
-		for (j = 0; j <= N; j++)
+		u = GRID_LINE(U, i);
+		r = GRID_LINE(R, i);
+		p = GRID_LINE(P, i);
+		jacobiLine(r, GRID_LINE(U, i - 1), u, GRID_LINE(U, i + 1), func, scale, N);
+
+		for (j = 1; j < N; j++)
+		{
+			r[j] = 4 * (r[j] - u[j]);
+			p[j] = r[j];
+			rr += r[j] * r[j];
+		}
+	}
+
+	while (options->term_iteration > 0)
+	{
+		TRACE_BEGIN(0, "iteration");
+		pq = 0;
+		rr_new = 0;
+		maxresiduum = 0;
+
+		/* q = Ap */
+		for (i = 1; i < N; i++)
+		{
+			p = GRID_LINE(P, i);
+			q = GRID_LINE(Q, i);
+
+			for (j = 1; j < N; j++)
+			{
+				q[j] = 4 * p[j] - (GRID(P, i - 1, j) + p[j - 1] + p[j + 1] + GRID(P, i + 1, j));
+				pq += p[j] * q[j];
+			}
+		}
+
+		alpha = (pq > 0) ? rr / pq : 0;
+
+		/* u = u + alpha p, r = r - alpha q */
+		for (i = 1; i < N; i++)
+		{
+			u = GRID_LINE(U, i);
+			r = GRID_LINE(R, i);
+			p = GRID_LINE(P, i);
+			q = GRID_LINE(Q, i);
+
+			for (j = 1; j < N; j++)
+			{
+				u[j] += alpha * p[j];
+				r[j] -= alpha * q[j];
+				rr_new += r[j] * r[j];
+				maxresiduum = (fabs(r[j]) < maxresiduum) ? maxresiduum : fabs(r[j]);
+			}
+		}
+
+		beta = (rr > 0) ? rr_new / rr : 0;
+		rr = rr_new;
+
+		/* p = r + beta p */
+		for (i = 1; i < N; i++)
+		{
+			r = GRID_LINE(R, i);
+			p = GRID_LINE(P, i);
+
+			for (j = 1; j < N; j++)
+			{
+				p[j] = r[j] + beta * p[j];
+			}
+		}
+
+		TRACE_END(0);
+
+		results->stat_iteration++;
+		results->stat_precision = maxresiduum * 0.25;
+
+		/* check for stopping calculation, depending on termination method */
+		if (options->termination == TERM_PREC)
+		{
+			if (results->stat_precision < options->term_precision)
+			{
+				options->term_iteration = 0;
+			}
+		}
+		else if (options->termination == TERM_ITER)
 		{
-			arguments->Matrix[i][j] = (double*)(arguments->M + (i * (N + 1) * (N + 1)) + (j * (N + 1)));
+			options->term_iteration--;
 		}
 	}
+
+	results->m = 0;
 }
 
 /* ************************************************************************ */
-/* initMatrices: Initialize matrix/matrices and some global variables       */
+/* calculateMixed: Jacobi with mixed precision. The sweeps run in float on  */
+/* the correction e of the approximation u: with d = star(u) - u as         */
+/* forcing term, Jacobi for e starting from e = 0 gives u + e = the same    */
+/* iterations as Jacobi for u, but e is small, so float loses nothing that  */
+/* matters. Half the bytes per point halve the memory traffic and the       */
+/* float kernel calculates twice the points per instruction. After the      */
+/* float residuum fell by MIXED_REDUCTION (or has not fallen for            */
+/* MIXED_STALL iterations), a double pass adds e to u and calculates the    */
+/* residuum and d anew (refinement), so term_precision is checked in double. */
 /* ************************************************************************ */
 static
 void
-initMatrices (struct calculation_arguments* arguments, struct options* options)
+calculateMixed (struct calculation_arguments* arguments, struct calculation_results *results, struct options* options)
 {
-	int g, i, j;                                /*  local variables for loops   */
-
+	int i, j;
+	int m1, m2;
 	int N = arguments->N;
-	double h = arguments->h;
-	double*** Matrix = arguments->Matrix;
+	int n;                                      /* float iterations of this correction            */
+	int stall;                                  /* iterations since the last new minimum          */
+	struct grid* U = &arguments->Matrix[0];     /* approximation                                  */
+	struct grid* Star = &arguments->Matrix[1];  /* its Jacobi iteration                           */
+	struct fgrid E[2];                          /* correction, two Jacobi matrices in float       */
+	struct fgrid D;                             /* star - u, forcing term of the correction       */
+	double const* func = NULL;                  /* forcing term of line i and its line factor     */
+	double scale = 0;
+	double residuum;
+	double maxresiduum;
+	float fresiduum;
+	float fmaxresiduum;
+	float best = 0;                             /* smallest float residuum of this correction     */
+	float limit;
+	struct timeval start, stop;
 
-	/* initialize matrix/matrices with zeros */
-	for (g = 0; g < arguments->num_matrices; g++)
+	allocateFloatGrid(&E[0], N + 1, N + 1);
+	allocateFloatGrid(&E[1], N + 1, N + 1);
+	allocateFloatGrid(&D, N + 1, N + 1);
+
+	for (i = 0; i <= N; i++)
 	{
-		for (i = 0; i <= N; i++)
+		for (j = 0; j <= N; j++)
 		{
-			for (j = 0; j <= N; j++)
-			{
-				Matrix[g][i][j] = 0;
-			}
+			GRID(&E[0], i, j) = 0;
+			GRID(&E[1], i, j) = 0;
+			GRID(&D, i, j) = 0;
 		}
 	}
 
-	/* initialize borders, depending on function (function 2: nothing to do) */
-	if (options->inf_func == FUNC_F0)
+	while (1)
 	{
-		for(i = 0; i <= N; i++)
+		/* double: residuum of u and forcing term of the correction */
+		TRACE_BEGIN(0, "double pass");
+		maxresiduum = 0;
+
+		for (i = 1; i < N; i++)
 		{
-			for (j = 0; j < arguments->num_matrices; j++)
+			if (options->inf_func == FUNC_FPISIN)
+			{
+				func = GRID_LINE(&arguments->Func, (arguments->Func.rows > 1) ? i : 0);
+				scale = GRID(&arguments->FuncScale, 0, i);
+			}
+
+			residuum = jacobiLine(GRID_LINE(Star, i), GRID_LINE(U, i - 1), GRID_LINE(U, i), GRID_LINE(U, i + 1), func, scale, N);
+			maxresiduum = (residuum < maxresiduum) ? maxresiduum : residuum;
+
+			for (j = 1; j < N; j++)
 			{
-				Matrix[j][i][0] = 1 - (h * i);
-				Matrix[j][i][N] = h * i;
-				Matrix[j][0][i] = 1 - (h * i);
-				Matrix[j][N][i] = h * i;
+				GRID(&D, i, j) = (float)(GRID(Star, i, j) - GRID(U, i, j));
 			}
 		}
 
-		for (j = 0; j < arguments->num_matrices; j++)
+		TRACE_END(0);
+
+		results->stat_precision = maxresiduum;
+		results->stat_refinements++;
+
+		if (options->term_iteration == 0 || maxresiduum < options->term_precision)
+		{
+			break;
+		}
+
+		/* float: Jacobi for the correction, from e = 0 */
+		gettimeofday(&start, NULL);
+
+		for (i = 1; i < N; i++)
+		{
+			for (j = 1; j < N; j++)
+			{
+				GRID(&E[0], i, j) = 0;
+				GRID(&E[1], i, j) = 0;
+			}
+		}
+
+		m1 = 0; m2 = 1;
+		n = 0;
+		stall = 0;
+		limit = maxresiduum * MIXED_REDUCTION;
+		limit = (limit < options->term_precision) ? options->term_precision : limit;
+
+		while (options->term_iteration > 0)
+		{
+			fmaxresiduum = 0;
+
+			TRACE_BEGIN(0, "float sweep");
+			for (i = 1; i < N; i++)
+			{
+				fresiduum = jacobiLineFloat(GRID_LINE(&E[m1], i), GRID_LINE(&E[m2], i - 1), GRID_LINE(&E[m2], i),
+				                            GRID_LINE(&E[m2], i + 1), GRID_LINE(&D, i), 1.0f, N);
+				fmaxresiduum = (fresiduum < fmaxresiduum) ? fmaxresiduum : fresiduum;
+			}
+			TRACE_END(0);
+
+			results->stat_iteration++;
+			results->stat_float_iteration++;
+
+			/* exchange m1 and m2 */
+			i=m1; m1=m2; m2=i;
+
+			if (options->termination == TERM_ITER)
+			{
+				options->term_iteration--;
+			}
+
+			stall = (n == 0 || fmaxresiduum < best) ? 0 : stall + 1;
+			best = (stall > 0) ? best : fmaxresiduum;
+			n++;
+
+			if (fmaxresiduum < limit || stall >= MIXED_STALL)
+			{
+				break;
+			}
+		}
+
+		/* double: u = u + e */
+		TRACE_BEGIN(0, "refinement");
+		for (i = 1; i < N; i++)
 		{
-			Matrix[j][N][0] = 0;
-			Matrix[j][0][N] = 0;
+			for (j = 1; j < N; j++)
+			{
+				GRID(U, i, j) += GRID(&E[m2], i, j);
+			}
 		}
+		TRACE_END(0);
+
+		gettimeofday(&stop, NULL);
+		results->stat_float_time += (stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) * 1e-6;
 	}
-}
-/* **************************************************************************************************** */
-/* Does the parralel part of the work calculate does. Needs to get the parameters as Call by Reference. */
-/* **************************************************************************************************** */
-//static
-//void
-//threadCalculate (int i, int j, int max_i, int max_j, double* maxresiduum, int* m1, int* m2, struct options* options, struct calculation_arguments* arguments)
-//{
-  //double star;
-  //double residuum;
-  //double t_maxresiduum;
-  //double*** Matrix = arguments->Matrix;
-  //double h = arguments->h;
-  //for (i = 1; i < max_i; i++)
-    //{
-      ///* over all columns */
-      //for (j = 1; j < max_j; j++)
-        //{
-          //star = (Matrix[*m2][i-1][j] + Matrix[*m2][i][j-1] + Matrix[*m2][i][j+1] + Matrix[*m2][i+1][j]) * 0.25;
-          //if (options->inf_func == FUNC_FPISIN)
-            //{
-              //star = (TWO_PI_SQUARE * sin((double)(j) * PI * h) * sin((double)(i) * PI * h) * h * h * 0.25) + star;
-            //}
-
-          //residuum = Matrix[*m2][i][j] - star; /* TODO residuum muss pro Thread gemacht werden */
-          //residuum = (residuum < 0) ? -residuum : residuum; /* Durch abs ersetzen (weil Prozessor befehle) */
-          //t_maxresiduum = (residuum < t_maxresiduum) ? t_maxresiduum : residuum;
-          //Matrix[*m1][i][j] = star;
-        //}
-    //}
-  ///* TODO maxresiduum muss zu mutex werden */
-  //*maxresiduum = (t_maxresiduum < *maxresiduum) ? *maxresiduum : t_maxresiduum; /* kann man so machen weil max gesucht wird nicht min */
-//}
 
+	freeFloatGrid(&E[0]);
+	freeFloatGrid(&E[1]);
+	freeFloatGrid(&D);
+
+	/* like Jacobi in double: the last iteration and the residuum before it */
+	results->m = 1;
+}
 
 /* ************************************************************************ */
 /* calculate: solves the equation                                           */
@@ -218,58 +1041,115 @@ static
 void
 calculate (struct calculation_arguments* arguments, struct calculation_results *results, struct options* options)
 {
-	int i, j;                                   /* local variables for loops  */
+	int i;                                      /* local variables for loops  */
 	int m1, m2;                                 /* used as indices for old and new matrices       */
-	double star;                                /* four times center value minus 4 neigh.b values */
+	int color, colors;                          /* half sweeps per iteration (red-black: 2)       */
+	int due;                                    /* the residuum of this iteration is evaluated    */
 	double residuum;                            /* residuum of current iteration                  */
 	double maxresiduum;                         /* maximum residuum value of a slave in iteration */
 
 	int N = arguments->N;
-	double h = arguments->h;
-	double*** Matrix = arguments->Matrix;
+	struct grid* Matrix = arguments->Matrix;
+	double* out;                                /* line i of the new matrix                       */
+	double const* up;                           /* lines i-1, i and i+1 of the old matrix         */
+	double const* mid;
+	double const* down;
+	double const* func = NULL;                  /* forcing term of line i and its line factor     */
+	double scale = 0;
+
+	/* Jacobi in float with refinement in double */
+	if (options->mixed)
+	{
+		calculateMixed(arguments, results, options);
+		return;
+	}
+
+	/* Jacobi: several iterations per pass over the matrix */
+	if (arguments->temporal > 0)
+	{
+		calculateTemporal(arguments, results, options);
+		return;
+	}
+
+	if (options->method == METH_MULTIGRID)
+	{
+		calculateMultigrid(arguments, results, options);
+		return;
+	}
+
+	if (options->method == METH_CG)
+	{
+		calculateCG(arguments, results, options);
+		return;
+	}
 
 	/* initialize m1 and m2 depending on algorithm */
-	if (options->method == METH_GAUSS_SEIDEL)
+	if (options->method == METH_JACOBI)
 	{
-		m1=0; m2=0;
+		m1=0; m2=1;
 	}
 	else
 	{
-		m1=0; m2=1;
+		m1=0; m2=0;
 	}
 
+	colors = (options->method == METH_RED_BLACK || options->method == METH_SOR) ? 2 : 1;
+
 	while (options->term_iteration > 0)
 	{
+		due = residualDue(&residual, results->stat_iteration + 1, options->term_iteration == 1);
 		maxresiduum = 0;
-		/* Pointer auf Threads */
-		//pthread_t threads[options->number]; /* Anzahl der Threads wird festgelegt durch User */
-		/* pthread create */
-		/* over all rows */
-		/* TODO ab hier muss es eine funktion werden die "in place" auf die Variablen zugreift */
-		//threadCalculate(1,1,N,N,&maxresiduum,&m1,&m2,options,arguments);
+		TRACE_BEGIN(0, "sweep");
+		/* red-black: all red points (i + j even) first, then all black points; */
+		/* the points of one color only depend on points of the other color     */
+		for (color = 0; color < colors; color++)
 		for (i = 1; i < N; i++)
 		{
-			/* over all columns */
-			for (j = 1; j < N; j++)
+			out = GRID_LINE(&Matrix[m1], i);
+			up = GRID_LINE(&Matrix[m2], i - 1);
+			mid = GRID_LINE(&Matrix[m2], i);
+			down = GRID_LINE(&Matrix[m2], i + 1);
+
+			if (options->inf_func == FUNC_FPISIN)
 			{
-				star = (Matrix[m2][i-1][j] + Matrix[m2][i][j-1] + Matrix[m2][i][j+1] + Matrix[m2][i+1][j]) * 0.25;
-		
-				if (options->inf_func == FUNC_FPISIN)
-				{
-					star = (TWO_PI_SQUARE * sin((double)(j) * PI * h) * sin((double)(i) * PI * h) * h * h * 0.25) + star;
-				}
-		
-				residuum = Matrix[m2][i][j] - star; /* TODO residuum muss pro Thread gemacht werden */
-				residuum = (residuum < 0) ? -residuum : residuum; /* Durch abs ersetzen (weil Prozessor befehle) */
-				maxresiduum = (residuum < maxresiduum) ? maxresiduum : residuum; /* TODO maxresiduum muss zu mutex werden */
-		
-				Matrix[m1][i][j] = star;
+				func = GRID_LINE(&arguments->Func, (arguments->Func.rows > 1) ? i : 0);
+				scale = GRID(&arguments->FuncScale, 0, i);
+			}
+
+			if (options->method == METH_JACOBI)
+			{
+				/* vectorized line kernel (stencil.c), the max. residuum is merged per line */
+				residuum = jacobiLine(out, up, mid, down, func, scale, N);
+			}
+			else if (options->method == METH_RED_BLACK)
+			{
+				/* only the points with (i + j) % 2 == color */
+				residuum = gaussSeidelLine(out, up, down, func, scale, N, 1 + (i + 1 + color) % 2, 2);
+			}
+			else if (options->method == METH_SOR)
+			{
+				/* red-black as above, over-relaxed by omega */
+				residuum = sorLine(out, up, down, func, scale, arguments->omega, N, 1 + (i + 1 + color) % 2, 2);
+			}
+			else
+			{
+				/* Gauss-Seidel: mid[j-1] was just calculated, so go point by point */
+				residuum = gaussSeidelLine(out, up, down, func, scale, N, 1, 1);
+			}
+
+			if (due)
+			{
+				maxresiduum = (residuum < maxresiduum) ? maxresiduum : residuum;
 			}
 		}
-                /* maxresiduum muss gesetzt werden */
-		/* pthreadjoin */
+		TRACE_END(0);
 		results->stat_iteration++;
-		results->stat_precision = maxresiduum;
+
+		if (due)
+		{
+			results->stat_precision = maxresiduum;
+			residualUpdate(&residual, results->stat_iteration, maxresiduum, options->term_precision);
+		}
 
 		/* exchange m1 and m2 */
 		i=m1; m1=m2; m2=i; /* normal swap */
@@ -283,7 +1163,7 @@ calculate (struct calculation_arguments* arguments, struct calculation_results *
 		/* check for stopping calculation, depending on termination method */
 		if (options->termination == TERM_PREC)
 		{
-			if (maxresiduum < options->term_precision) 
+			if (due && maxresiduum < options->term_precision)
 			{
 				options->term_iteration = 0;
 			}
@@ -296,6 +1176,47 @@ calculate (struct calculation_arguments* arguments, struct calculation_results *
 
 	results->m = m2;
 }
+/* ************************************************************************ */
+/* trafficModel: bytes from and to memory per point and iteration for the   */
+/* roofline report, compulsory traffic without write allocate as in         */
+/* benchmark.sh: every pass reads and writes each matrix value once and     */
+/* reads the forcing term table (the separable form stays in the cache).    */
+/* Describes the layout in model; 0: no model for the method                */
+/* ************************************************************************ */
+static
+double
+trafficModel (struct calculation_arguments* arguments, struct options* options, char* model, size_t size)
+{
+	int passes = (options->method == METH_RED_BLACK || options->method == METH_SOR) ? 2 : 1;
+	int table = (options->inf_func == FUNC_FPISIN && arguments->Func.rows > 1);
+	char const* matrix = (options->method == METH_JACOBI) ? "2 Matrizen" : "1 Matrix";
+	double bytes = 16.0 * passes + ((table) ? 8.0 * passes : 0);
+
+	if (options->method == METH_MULTIGRID || options->method == METH_CG)
+	{
+		snprintf(model, size, "keines fuer %s", (options->method == METH_CG) ? "CG" : "Mehrgitter");
+		return 0;
+	}
+
+	/* float correction: read and write 4 bytes, read the right side (4) */
+	if (options->mixed)
+	{
+		bytes = 12.0;
+		matrix = "Korrektur float";
+	}
+
+	/* temporal blocking: one pass over the matrix per wavefront */
+	if (arguments->temporal > 0)
+	{
+		bytes /= arguments->temporal;
+	}
+
+	snprintf(model, size, "%.1f Byte pro Punkt (%s, Stoerfunktion %s)", bytes, matrix,
+	         (options->inf_func == FUNC_F0) ? "keine" : (table) ? "Tabelle" : "separabel");
+
+	return bytes;
+}
+
 /* ************************************************************************ */
 /*  displayStatistics: displays some statistics about the calculation       */
 /* ************************************************************************ */
@@ -311,23 +1232,42 @@ displayStatistics (struct calculation_arguments* arguments, struct calculation_r
 	//Calculate Flops
 	// star op = 5 ASM ops (+1 XOR) with -O3, matrix korrektur = 1
 	double q = 6;
+	double q_func = 0;
 	double mflops;
 
-	if (options->inf_func == FUNC_F0)
+	// residuum: checked 1 flop in ASM, verified on Nehalem architecture.
+	q += 1.0;
+
+	if (options->method == METH_SOR)
 	{
-		// residuum: checked 1 flop in ASM, verified on Nehalem architecture.
-		q += 1.0;
+		// over-relaxation: one multiplication with omega and one addition
+		q += 2.0;
 	}
-	else
+
+	if (options->inf_func == FUNC_FPISIN)
 	{
-		// residuum: 11 with O0, but 10 with "gcc -O3", without counting sin & cos
-		q += 10.0;
+		// forcing term: precomputed, one multiplication with the line factor and one addition
+		q_func = 2.0;
 	}
 
-	/* calculate flops  */
-	mflops = (q * (N - 1) * (N - 1) * results->stat_iteration) * 1e-6;
+	/* calculate flops, with and without the forcing term */
+	mflops = ((q + q_func) * (N - 1) * (N - 1) * results->stat_iteration) * 1e-6;
 	printf("Executed float ops: %f MFlop\n", mflops);
 	printf("Speed:              %f MFlop/s\n", mflops / time);
+	printf("Speed ohne Stoerf.: %f MFlop/s\n", (q * (N - 1) * (N - 1) * results->stat_iteration) * 1e-6 / time);
+
+	if (counters != NULL)
+	{
+		counterReport(counters, 1, "Thread", mflops, time);
+	}
+
+	if (roofline != NULL)
+	{
+		char model[160];
+		double bytes = trafficModel(arguments, options, model, sizeof(model));
+
+		rooflineReport(roofline, 1, "Threads", mflops, bytes * (N - 1) * (N - 1) * results->stat_iteration * 1e-6, time, model);
+	}
 
 	printf("Berechnungsmethode: ");
 
@@ -339,8 +1279,51 @@ displayStatistics (struct calculation_arguments* arguments, struct calculation_r
 	{
 		printf("Jacobi");
 	}
+	else if (options->method == METH_RED_BLACK)
+	{
+		printf("Gauss-Seidel (Rot-Schwarz)");
+	}
+	else if (options->method == METH_MULTIGRID)
+	{
+		printf("Mehrgitterverfahren");
+	}
+	else if (options->method == METH_CG)
+	{
+		printf("Konjugierte Gradienten");
+	}
+	else if (options->method == METH_SOR)
+	{
+		printf("SOR (Rot-Schwarz)");
+	}
 
 	printf("\n");
+	printf("Rechenkern:         %s\n", stencilName());
+
+	if (options->method == METH_MULTIGRID)
+	{
+		printf("Mehrgitter:         %s-Zyklus, %d Gitter (%d .. %d), Glaetter %s\n", (options->cycle == CYCLE_F) ? "F" : "V",
+		       arguments->levels, arguments->N, arguments->Level[arguments->levels - 1].N,
+		       (options->smoother == METH_JACOBI) ? "Jacobi" : ((options->smoother == METH_RED_BLACK) ? "Rot-Schwarz" : "Gauss-Seidel"));
+	}
+
+	if (options->method == METH_SOR)
+	{
+		printf("Relaxation:         omega = %f (%s)\n", arguments->omega, (options->omega > 0) ? "--omega" : "2/(1+sin(pi h))");
+	}
+
+	if (options->mixed)
+	{
+		printf("Genauigkeit:        %d Iterationen float (%f s), %d Korrekturen double (%f s)\n", results->stat_float_iteration,
+		       results->stat_float_time, results->stat_refinements, time - results->stat_float_time);
+	}
+
+	if (arguments->temporal > 0)
+	{
+		printf("Zeitblockung:       %d Iterationen, Baender von %d Spalten\n", arguments->temporal, arguments->width);
+	}
+
+	residualReport(&residual, results->stat_iteration);
+
 	printf("Interlines:         %d\n",options->interlines);
 	printf("Stoerfunktion:      ");
 
@@ -382,21 +1365,57 @@ main (int argc, char** argv)
 
 	/* get parameters */
 	AskParams(&options, argc, argv);              /* ************************* */
+	initStencil();                                /*  select line kernel       */
 
 	initVariables(&arguments, &results, &options);           /* ******************************************* */
 
 	allocateMatrices(&arguments);        /*  get and initialize variables and matrices  */
 	initMatrices(&arguments, &options);            /* ******************************************* */
+	initFunction(&arguments, &options);            /*  precompute forcing term                    */
+
+	if (options.roofline)
+	{
+		roofline = malloc(sizeof(struct roofline));
+		rooflineProbe(roofline, ROOFLINE_ELEMENTS);
+	}
+
+	if (counterEnabled())
+	{
+		counters = malloc(sizeof(struct counters));
+	}
+
+	/* PARTDIFF_TRACE=<file>: events of calculate() */
+	if (traceWanted())
+	{
+		traceInit(1, 0);
+	}
+
+	residualInit(&residual, options.adaptive, options.termination == TERM_PREC, options.method != METH_SOR);
 
 	gettimeofday(&start_time, NULL);                   /*  start timer         */
+
+	if (counters != NULL)
+	{
+		counterStart(counters);
+	}
+
 	calculate(&arguments, &results, &options);                                      /*  solve the equation  */
+
+	if (counters != NULL)
+	{
+		counterStop(counters);
+	}
+
 	gettimeofday(&comp_time, NULL);                   /*  stop timer          */
 
 	displayStatistics(&arguments, &results, &options);                                  /* **************** */
 	DisplayMatrix("Matrix:",                              /*  display some    */
-			arguments.Matrix[results.m][0], options.interlines);            /*  statistics and  */
+			&arguments.Matrix[results.m], options.interlines);            /*  statistics and  */
 
 	freeMatrices(&arguments);                                       /*  free memory     */
+	free(counters);
+	free(roofline);
+	traceFinish();
 
 	return 0;
 }
@@ -0,0 +1,175 @@
+/****************************************************************************/
+/****************************************************************************/
+/**                                                                        **/
+/**                TU Muenchen - Institut fuer Informatik                  **/
+/**                                                                        **/
+/** Copyright: Prof. Dr. Thomas Ludwig                                     **/
+/**            Andreas C. Schmidt                                          **/
+/**                                                                        **/
+/** File:      residual.c                                                  **/
+/**                                                                        **/
+/** Purpose:   Adaptive evaluation of the maximum residuum. The line       **/
+/**            kernels always return it (abs and max stay in registers     **/
+/**            and cost nothing next to the memory traffic), but merging   **/
+/**            it over threads, reducing it over processes and checking    **/
+/**            the termination is only done every few iterations:          **/
+/**                                                                        **/
+/**            With TERM_ITER only the last iteration is evaluated, it     **/
+/**            gives stat_precision.                                       **/
+/**                                                                        **/
+/**            With TERM_PREC two evaluations give the contraction per     **/
+/**            iteration, rate = (r2 / r1)^(1 / (t2 - t1)), and so the     **/
+/**            distance to the precision, log(precision / r2) /            **/
+/**            log(rate). t2 - t1 is at least RESIDUAL_BASE: the Jacobi    **/
+/**            residuum often stays the same for two iterations. The next  **/
+/**            evaluation comes after RESIDUAL_SAFETY of that distance,    **/
+/**            but the gaps at most double from one to the next, so they   **/
+/**            shrink towards the predicted stop and the iterations        **/
+/**            around it are all evaluated. A faster contraction than      **/
+/**            observed can still reach the precision inside a gap;        **/
+/**            residualReport() says by how many iterations the            **/
+/**            calculation may have run too long then.                     **/
+/**                                                                        **/
+/**            SOR overshoots and its residuum jumps, there every          **/
+/**            iteration of TERM_PREC is evaluated.                        **/
+/**                                                                        **/
+/**            The decisions depend only on the residuals, which are the   **/
+/**            same in every run, so the iterations are reproducible.      **/
+/**                                                                        **/
+/****************************************************************************/
+/****************************************************************************/
+
+#include <stdio.h>
+#include <limits.h>
+#include <math.h>
+#include "residual.h"
+
+/* ************************************************************************ */
+/* residualInit: adaptive: --residual=adaptive, precision: TERM_PREC,       */
+/* smooth: the residuum of the method falls smoothly, it can be predicted   */
+/* ************************************************************************ */
+void
+residualInit (struct residual* r, int adaptive, int precision, int smooth)
+{
+	r->adaptive = adaptive;
+	r->precision = precision;
+	r->smooth = smooth;
+	r->next = (precision) ? 1 : INT_MAX;
+	r->last = 0;
+	r->value = 0;
+	r->base = 0;
+	r->base_value = 0;
+	r->rate = 0;
+	r->step = 1;
+	r->evaluations = 0;
+	r->gap = 0;
+	r->time = 0;
+}
+
+/* ************************************************************************ */
+/* residualDue: 1 if iteration (counted from 1) must be evaluated; final:   */
+/* it is the last one of TERM_ITER (or MAX_ITERATION)                       */
+/* ************************************************************************ */
+int
+residualDue (struct residual const* r, int iteration, int final)
+{
+	return (!r->adaptive || final || iteration >= r->next);
+}
+
+/* ************************************************************************ */
+/* residualUpdate: iteration was evaluated with the maximum residuum value  */
+/* of all threads and processes; plans the next evaluation                  */
+/* ************************************************************************ */
+void
+residualUpdate (struct residual* r, int iteration, double value, double precision)
+{
+	double distance = 0;
+	int step;
+
+	if (!r->adaptive)
+	{
+		return;
+	}
+
+	/* only a contraction gives a rate, else evaluate every iteration */
+	if (0 == r->base)
+	{
+		r->base = iteration;
+		r->base_value = value;
+	}
+	else if (iteration - r->base >= RESIDUAL_BASE)
+	{
+		r->rate = (value > 0 && value < r->base_value) ? pow(value / r->base_value, 1.0 / (iteration - r->base)) : 0;
+		r->base = iteration;
+		r->base_value = value;
+	}
+
+	if (r->precision && value < precision)
+	{
+		r->gap = iteration - r->last;
+	}
+
+	r->last = iteration;
+	r->value = value;
+	r->evaluations++;
+
+	if (!r->precision)
+	{
+		return;
+	}
+
+	if (r->smooth && r->rate > 0 && value > precision)
+	{
+		distance = log(precision / value) / log(r->rate);
+	}
+
+	step = (int)(distance * RESIDUAL_SAFETY);
+	step = (step > 2 * r->step) ? 2 * r->step : step;
+	step = (step < 1) ? 1 : ((step > RESIDUAL_MAX_GAP) ? RESIDUAL_MAX_GAP : step);
+	r->step = step;
+	r->next = iteration + step;
+}
+
+/* ************************************************************************ */
+/* residualReport: evaluations of the calculation of iterations iterations  */
+/* and the time saved, estimated from the time of the evaluations (if the   */
+/* caller measured it); that includes waiting for slower processes, which   */
+/* partly moves to the next halo exchange, so it is an upper bound          */
+/* ************************************************************************ */
+void
+residualReport (struct residual const* r, int iterations)
+{
+	double each;
+
+	if (!r->adaptive)
+	{
+		return;
+	}
+
+	/* the other solvers (multigrid, CG, temporal blocking, ...) ignore it */
+	if (0 == r->evaluations)
+	{
+		printf("Residuum:           --residual=adaptive gilt hier nicht, jede Iteration ausgewertet\n");
+		return;
+	}
+
+	each = r->time / r->evaluations;
+
+	/* the sequential program merges with one compare per line, nothing to time */
+	if (r->time > 0)
+	{
+		printf("Residuum:           adaptiv, %d von %d Iterationen ausgewertet, bis zu %f s gespart (%.2f us pro Auswertung)\n",
+		       r->evaluations, iterations, (iterations - r->evaluations) * each, each * 1e6);
+	}
+	else
+	{
+		printf("Residuum:           adaptiv, %d von %d Iterationen ausgewertet\n",
+		       r->evaluations, iterations);
+	}
+
+	if (r->gap > 1)
+	{
+		printf("                    Genauigkeit in einer Luecke von %d Iterationen erreicht, bis zu %d zu viel\n",
+		       r->gap, r->gap - 1);
+	}
+}
@@ -0,0 +1,63 @@
+/****************************************************************************/
+/****************************************************************************/
+/**                                                                        **/
+/**                TU Muenchen - Institut fuer Informatik                  **/
+/**                                                                        **/
+/** Copyright: Prof. Dr. Thomas Ludwig                                     **/
+/**            Andreas C. Schmidt                                          **/
+/**                                                                        **/
+/** File:      residual.h                                                  **/
+/**                                                                        **/
+/** Purpose:   Adaptive evaluation of the maximum residuum                 **/
+/**            (--residual=adaptive): which iterations merge, reduce and   **/
+/**            check it, chosen from the observed contraction.             **/
+/**                                                                        **/
+/****************************************************************************/
+/****************************************************************************/
+
+#ifndef RESIDUAL_H
+#define RESIDUAL_H
+
+/* ************* */
+/* Some defines. */
+/* ************* */
+#define RESIDUAL_SAFETY		0.5	/* next evaluation after this part of the predicted distance */
+#define RESIDUAL_MAX_GAP	256	/* max. iterations between two evaluations */
+#define RESIDUAL_BASE		8	/* min. iterations for a contraction rate (Jacobi alternates) */
+
+/* ************************************************************************ */
+/* The evaluations of one calculation; every thread (process) that decides  */
+/* about the termination keeps its own copy, they all see the same values   */
+/* and so make the same decisions.                                          */
+/* ************************************************************************ */
+struct residual
+{
+	int     adaptive;       /* --residual=adaptive, else every iteration      */
+	int     precision;      /* TERM_PREC, else only the last iteration        */
+	int     smooth;         /* the residuum falls smoothly (not SOR)          */
+	int     next;           /* iteration of the next evaluation               */
+	int     last;           /* iteration of the last evaluation, 0: none      */
+	double  value;          /* its maximum residuum                           */
+	int     base;           /* evaluation the rate is measured from           */
+	double  base_value;
+	double  rate;           /* contraction per iteration, 0: unknown          */
+	int     step;           /* iterations to the next evaluation              */
+	int     evaluations;    /* so far                                         */
+	int     gap;            /* iterations before the one below the precision  */
+	double  time;           /* seconds in evaluations, added by the caller    */
+};
+
+/* *************************** */
+/* Some function declarations. */
+/* *************************** */
+/* Documentation in residual.c */
+/* *************************** */
+void residualInit ( struct residual*, int, int, int );
+
+int residualDue ( struct residual const*, int, int );
+
+void residualUpdate ( struct residual*, int, double, double );
+
+void residualReport ( struct residual const*, int );
+
+#endif
@@ -0,0 +1,387 @@
+/****************************************************************************/
+/****************************************************************************/
+/**                                                                        **/
+/**                TU Muenchen - Institut fuer Informatik                  **/
+/**                                                                        **/
+/** Copyright: Prof. Dr. Thomas Ludwig                                     **/
+/**            Andreas C. Schmidt                                          **/
+/**                                                                        **/
+/** File:      roofline.c                                                  **/
+/**                                                                        **/
+/** Purpose:   Roofline model of the solver (--roofline). Every thread     **/
+/**            (or MPI process) runs rooflineProbe() at the same time: a   **/
+/**            STREAM triad on its own arrays (first touch) for the        **/
+/**            memory bandwidth and independent FMA chains in the vector   **/
+/**            width of the selected stencil kernel for the peak. The      **/
+/**            report compares the calculation with min(peak, I * BW).     **/
+/**                                                                        **/
+/****************************************************************************/
+/****************************************************************************/
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "roofline.h"
+#include "stencil.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ROOFLINE_X86
+#include <immintrin.h>
+#endif
+
+/* a = a * PEAK_MUL + PEAK_ADD converges to 2, no overflow, no denormals */
+#define PEAK_MUL	0.5
+#define PEAK_ADD	1.0
+
+/* ten independent chains hide the FMA latency on two pipelines */
+#define CHAINS(X)	X(0) X(1) X(2) X(3) X(4) X(5) X(6) X(7) X(8) X(9)
+#define PEAK_CHAINS	10
+
+/* ************************************************************************ */
+/* now: seconds since some fixed point in time                              */
+/* ************************************************************************ */
+static
+double
+now (void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* ************************************************************************ */
+/* peakScalar: n iterations of the chains, multiply and add, 1 value wide   */
+/* ************************************************************************ */
+static
+double
+peakScalar (long n)
+{
+	long i;
+
+#define DECLARE(k)	double a##k = k;
+#define STEP(k)		a##k = a##k * PEAK_MUL + PEAK_ADD;
+#define SUM(k)		+ a##k
+	CHAINS(DECLARE)
+
+	for (i = 0; i < n; i++)
+	{
+		CHAINS(STEP)
+	}
+
+	return 0 CHAINS(SUM);
+#undef DECLARE
+#undef STEP
+#undef SUM
+}
+
+#ifdef ROOFLINE_X86
+
+/* ************************************************************************ */
+/* peakSSE2: multiply and add, 2 values wide                                */
+/* ************************************************************************ */
+__attribute__((target("sse2")))
+static
+double
+peakSSE2 (long n)
+{
+	long i;
+	double sum[2];
+	__m128d m = _mm_set1_pd(PEAK_MUL);
+	__m128d b = _mm_set1_pd(PEAK_ADD);
+
+#define DECLARE(k)	__m128d a##k = _mm_set1_pd(k);
+#define STEP(k)		a##k = _mm_add_pd(_mm_mul_pd(a##k, m), b);
+#define SUM(k)		s = _mm_add_pd(s, a##k);
+	CHAINS(DECLARE)
+
+	for (i = 0; i < n; i++)
+	{
+		CHAINS(STEP)
+	}
+
+	{
+		__m128d s = _mm_setzero_pd();
+		CHAINS(SUM)
+		_mm_storeu_pd(sum, s);
+	}
+
+	return sum[0] + sum[1];
+#undef DECLARE
+#undef STEP
+#undef SUM
+}
+
+/* ************************************************************************ */
+/* peakAVX2: fused multiply-add, 4 values wide                              */
+/* ************************************************************************ */
+__attribute__((target("avx2,fma")))
+static
+double
+peakAVX2 (long n)
+{
+	long i;
+	double sum[4];
+	__m256d m = _mm256_set1_pd(PEAK_MUL);
+	__m256d b = _mm256_set1_pd(PEAK_ADD);
+
+#define DECLARE(k)	__m256d a##k = _mm256_set1_pd(k);
+#define STEP(k)		a##k = _mm256_fmadd_pd(a##k, m, b);
+#define SUM(k)		s = _mm256_add_pd(s, a##k);
+	CHAINS(DECLARE)
+
+	for (i = 0; i < n; i++)
+	{
+		CHAINS(STEP)
+	}
+
+	{
+		__m256d s = _mm256_setzero_pd();
+		CHAINS(SUM)
+		_mm256_storeu_pd(sum, s);
+	}
+
+	return sum[0] + sum[1] + sum[2] + sum[3];
+#undef DECLARE
+#undef STEP
+#undef SUM
+}
+
+/* ************************************************************************ */
+/* peakAVX512: fused multiply-add, 8 values wide                            */
+/* ************************************************************************ */
+__attribute__((target("avx512f")))
+static
+double
+peakAVX512 (long n)
+{
+	long i;
+	__m512d m = _mm512_set1_pd(PEAK_MUL);
+	__m512d b = _mm512_set1_pd(PEAK_ADD);
+
+#define DECLARE(k)	__m512d a##k = _mm512_set1_pd(k);
+#define STEP(k)		a##k = _mm512_fmadd_pd(a##k, m, b);
+#define SUM(k)		s = _mm512_add_pd(s, a##k);
+	CHAINS(DECLARE)
+
+	for (i = 0; i < n; i++)
+	{
+		CHAINS(STEP)
+	}
+
+	{
+		__m512d s = _mm512_setzero_pd();
+		CHAINS(SUM)
+		return _mm512_reduce_add_pd(s);
+	}
+#undef DECLARE
+#undef STEP
+#undef SUM
+}
+
+#endif
+
+/* ************************************************************************ */
+/* peakWidth: values per vector of the chains, the vector width of the      */
+/* stencil kernel; name: instruction set (with FMA where available)         */
+/* ************************************************************************ */
+static
+int
+peakWidth (char const** name)
+{
+	char const* kernel = stencilName();
+
+#ifdef ROOFLINE_X86
+	__builtin_cpu_init();
+
+	if (strcmp(kernel, "avx512") == 0)
+	{
+		*name = "avx512 FMA";
+		return 8;
+	}
+	else if (strcmp(kernel, "avx2") == 0 && __builtin_cpu_supports("fma"))
+	{
+		*name = "avx2 FMA";
+		return 4;
+	}
+	else if (strcmp(kernel, "scalar") != 0)
+	{
+		*name = "sse2";
+		return 2;
+	}
+#endif
+
+	(void)kernel;
+	*name = "skalar";
+
+	return 1;
+}
+
+/* ************************************************************************ */
+/* peak: n iterations of the chains in the width of peakWidth(), returns    */
+/* the flops                                                                */
+/* ************************************************************************ */
+static
+double
+peak (long n)
+{
+	char const* name;
+	int width = peakWidth(&name);
+	volatile double sink;                       /* keeps the chains alive                     */
+
+#ifdef ROOFLINE_X86
+	if (8 == width)
+	{
+		sink = peakAVX512(n);
+	}
+	else if (4 == width)
+	{
+		sink = peakAVX2(n);
+	}
+	else if (2 == width)
+	{
+		sink = peakSSE2(n);
+	}
+	else
+#endif
+	{
+		sink = peakScalar(n);
+	}
+
+	(void)sink;
+
+	return 2.0 * width * PEAK_CHAINS * n;
+}
+
+/* ************************************************************************ */
+/* rooflineProbe: measures the calling thread; n: its share of the triad    */
+/* arrays, all threads should start at the same time                        */
+/*   triad:  a[i] = b[i] + 3 * c[i], 24 bytes per element (STREAM, without  */
+/*           write allocate), fastest of ROOFLINE_REPEAT runs               */
+/*   peak:   ROOFLINE_FMA iterations of the chains, fastest run             */
+/* ************************************************************************ */
+void
+rooflineProbe (struct roofline* r, size_t n)
+{
+	size_t i;
+	int k;
+	double start, time;
+	double* a = malloc(n * sizeof(double));
+	double* b = malloc(n * sizeof(double));
+	double* c = malloc(n * sizeof(double));
+
+	if (a == NULL || b == NULL || c == NULL)
+	{
+		printf("Speicherprobleme! (%lu Bytes fuer --roofline)\n", (unsigned long)(3 * n * sizeof(double)));
+		exit(1);
+	}
+
+	/* first touch by this thread, then one run to warm up */
+	for (i = 0; i < n; i++)
+	{
+		a[i] = 0;
+		b[i] = 1;
+		c[i] = 2;
+	}
+
+	r->bytes = 3.0 * sizeof(double) * n;
+	r->bytes_time = 0;
+
+	for (k = 0; k <= ROOFLINE_REPEAT; k++)
+	{
+		start = now();
+
+		for (i = 0; i < n; i++)
+		{
+			a[i] = b[i] + 3.0 * c[i];
+		}
+
+		time = now() - start;
+
+		if (k > 0 && (r->bytes_time == 0 || time < r->bytes_time))
+		{
+			r->bytes_time = time;
+		}
+	}
+
+	/* the results are used so that the triads are not optimized away */
+	if (a[n / 2] != 7.0)
+	{
+		printf("Triad falsch: %f\n", a[n / 2]);
+	}
+
+	free(a);
+	free(b);
+	free(c);
+
+	r->flops_time = 0;
+
+	for (k = 0; k < ROOFLINE_REPEAT; k++)
+	{
+		start = now();
+		r->flops = peak(ROOFLINE_FMA);
+		time = now() - start;
+
+		if (r->flops_time == 0 || time < r->flops_time)
+		{
+			r->flops_time = time;
+		}
+	}
+}
+
+/* ************************************************************************ */
+/* rooflineReport: bandwidth and peak of n threads (or processes, unit),    */
+/* the intensity of the calculation (mflop over mbyte in the traffic model  */
+/* described by model; mbyte 0: no model) and how close the calculation of  */
+/* seconds comes to the roof min(peak, intensity * bandwidth)               */
+/* ************************************************************************ */
+void
+rooflineReport (struct roofline const* r, int n, char const* unit, double mflop, double mbyte, double seconds, char const* model)
+{
+	int t;
+	double bytes = 0, bytes_time = 0;
+	double flops = 0, flops_time = 0;
+	double bandwidth, top, intensity, roof;
+	char const* name;
+
+	/* the threads ran at the same time: all bytes over the slowest thread */
+	for (t = 0; t < n; t++)
+	{
+		bytes += r[t].bytes;
+		flops += r[t].flops;
+		bytes_time = (r[t].bytes_time < bytes_time) ? bytes_time : r[t].bytes_time;
+		flops_time = (r[t].flops_time < flops_time) ? flops_time : r[t].flops_time;
+	}
+
+	bandwidth = bytes / bytes_time * 1e-9;
+	top = flops / flops_time * 1e-9;
+
+	peakWidth(&name);
+
+	printf("Roofline:           Triad %.2f GB/s, Spitze %.2f GFlop/s (%s), %d %s\n", bandwidth, top, name, n, unit);
+	printf("Verkehrsmodell:     %s\n", model);
+
+	if (mbyte <= 0)
+	{
+		printf("Erreicht:           %.2f GFlop/s = %.1f %% der Spitze\n", mflop * 1e-3 / seconds, mflop * 1e-3 / seconds / top * 100);
+		return;
+	}
+
+	intensity = mflop / mbyte;
+	roof = (intensity * bandwidth < top) ? intensity * bandwidth : top;
+
+	printf("Intensitaet:        %.3f Flop/Byte (Knick bei %.3f Flop/Byte)\n", intensity, top / bandwidth);
+	printf("Erreicht:           %.2f GFlop/s, %.2f GB/s\n", mflop * 1e-3 / seconds, mbyte * 1e-3 / seconds);
+	printf("Dach:               %.2f GFlop/s (%s), erreicht %.1f %%\n", roof, (roof < top) ? "Speicher" : "Spitze",
+	       mflop * 1e-3 / seconds / roof * 100);
+
+	/* the triad arrays are larger than the caches, small matrices are not */
+	if (mflop * 1e-3 / seconds > roof)
+	{
+		printf("                    ueber dem Dach: die Matrizen liegen (teilweise) im Cache\n");
+	}
+}
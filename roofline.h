@@ -0,0 +1,49 @@
+/****************************************************************************/
+/****************************************************************************/
+/**                                                                        **/
+/**                TU Muenchen - Institut fuer Informatik                  **/
+/**                                                                        **/
+/** Copyright: Prof. Dr. Thomas Ludwig                                     **/
+/**            Andreas C. Schmidt                                          **/
+/**                                                                        **/
+/** File:      roofline.h                                                  **/
+/**                                                                        **/
+/** Purpose:   Bandwidth (STREAM triad) and peak (FMA chains) probes per   **/
+/**            thread and the roofline report (--roofline).                **/
+/**                                                                        **/
+/****************************************************************************/
+/****************************************************************************/
+
+#ifndef ROOFLINE_H
+#define ROOFLINE_H
+
+#include <stddef.h>
+
+/* ************* */
+/* Some defines. */
+/* ************* */
+#define ROOFLINE_ELEMENTS	(1 << 23)	/* triad: doubles per array, all threads */
+#define ROOFLINE_FMA		(1 << 22)	/* peak: iterations of the FMA chains    */
+#define ROOFLINE_REPEAT		5		/* best of so many runs                  */
+
+/* ************************************************************************ */
+/* The result of rooflineProbe() in one thread                              */
+/* ************************************************************************ */
+struct roofline
+{
+	double  bytes;          /* bytes of one triad                             */
+	double  bytes_time;     /* seconds of the fastest triad                   */
+	double  flops;          /* flops of one run of the FMA chains             */
+	double  flops_time;     /* seconds of the fastest run                     */
+};
+
+/* *************************** */
+/* Some function declarations. */
+/* *************************** */
+/* Documentation in roofline.c */
+/* *************************** */
+void rooflineProbe ( struct roofline*, size_t );
+
+void rooflineReport ( struct roofline const*, int, char const*, double, double, double, char const* );
+
+#endif
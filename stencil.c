@@ -0,0 +1,538 @@
+/****************************************************************************/
+/****************************************************************************/
+/**                                                                        **/
+/**                TU Muenchen - Institut fuer Informatik                  **/
+/**                                                                        **/
+/** Copyright: Prof. Dr. Thomas Ludwig                                     **/
+/**            Andreas C. Schmidt                                          **/
+/**                                                                        **/
+/** File:      stencil.c                                                   **/
+/**                                                                        **/
+/** Purpose:   Jacobi line kernels for SSE2, AVX2 and AVX-512 with a       **/
+/**            scalar fallback. initStencil() picks the widest kernel the  **/
+/**            processor supports (CPUID). The environment variable        **/
+/**            PARTDIFF_KERNEL=scalar|sse2|avx2|avx512 overrides this.     **/
+/**            Gauss-Seidel and SOR line kernels for both update orders.   **/
+/**            The same Jacobi kernels in float for mixed precision.       **/
+/**                                                                        **/
+/****************************************************************************/
+/****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stencil.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define STENCIL_X86
+#include <immintrin.h>
+#endif
+
+jacobi_line_t jacobiLine;
+jacobi_line_float_t jacobiLineFloat;
+
+static const char* kernel_name = "scalar";
+
+/* ************************************************************************ */
+/* jacobiLineScalar: reference kernel, one point after the other            */
+/* ************************************************************************ */
+static
+double
+jacobiLineScalar (double* out, double const* up, double const* mid, double const* down,
+                  double const* func, double scale, int n)
+{
+	int j;
+	double star;
+	double residuum;
+	double maxresiduum = 0;
+
+	for (j = 1; j < n; j++)
+	{
+		star = (up[j] + mid[j-1] + mid[j+1] + down[j]) * 0.25;
+
+		if (func != NULL)
+		{
+			star = (func[j] * scale) + star;
+		}
+
+		residuum = mid[j] - star;
+		residuum = (residuum < 0) ? -residuum : residuum;
+		maxresiduum = (residuum < maxresiduum) ? maxresiduum : residuum;
+
+		out[j] = star;
+	}
+
+	return maxresiduum;
+}
+
+/* ************************************************************************ */
+/* jacobiLineFloatScalar: jacobiLineScalar in float                         */
+/* ************************************************************************ */
+static
+float
+jacobiLineFloatScalar (float* out, float const* up, float const* mid, float const* down,
+                       float const* func, float scale, int n)
+{
+	int j;
+	float star;
+	float residuum;
+	float maxresiduum = 0;
+
+	for (j = 1; j < n; j++)
+	{
+		star = (up[j] + mid[j-1] + mid[j+1] + down[j]) * 0.25f;
+
+		if (func != NULL)
+		{
+			star = (func[j] * scale) + star;
+		}
+
+		residuum = mid[j] - star;
+		residuum = (residuum < 0) ? -residuum : residuum;
+		maxresiduum = (residuum < maxresiduum) ? maxresiduum : residuum;
+
+		out[j] = star;
+	}
+
+	return maxresiduum;
+}
+
+/* ************************************************************************ */
+/* gaussSeidelLine: updates line in place at first, first+step, ... < n     */
+/* and returns the maximum of |line[j] - star| of the updated points.       */
+/* With step 1 this is the lexicographic Gauss-Seidel order (line[j-1] is   */
+/* already new), with step 2 one color of the red-black order.              */
+/* ************************************************************************ */
+double
+gaussSeidelLine (double* line, double const* up, double const* down,
+                 double const* func, double scale, int n, int first, int step)
+{
+	int j;
+	double star;
+	double residuum;
+	double maxresiduum = 0;
+
+	for (j = first; j < n; j += step)
+	{
+		star = (up[j] + line[j-1] + line[j+1] + down[j]) * 0.25;
+
+		if (func != NULL)
+		{
+			star = (func[j] * scale) + star;
+		}
+
+		residuum = line[j] - star;
+		residuum = (residuum < 0) ? -residuum : residuum;
+		maxresiduum = (residuum < maxresiduum) ? maxresiduum : residuum;
+
+		line[j] = star;
+	}
+
+	return maxresiduum;
+}
+
+/* ************************************************************************ */
+/* sorLine: like gaussSeidelLine, but moves line[j] only omega times the    */
+/* way from its old value to star (successive over-relaxation, omega = 1    */
+/* is Gauss-Seidel). Returns the maximum of |line[j] - star|, so the        */
+/* residuum does not depend on omega.                                       */
+/* ************************************************************************ */
+double
+sorLine (double* line, double const* up, double const* down,
+         double const* func, double scale, double omega, int n, int first, int step)
+{
+	int j;
+	double star;
+	double residuum;
+	double maxresiduum = 0;
+
+	for (j = first; j < n; j += step)
+	{
+		star = (up[j] + line[j-1] + line[j+1] + down[j]) * 0.25;
+
+		if (func != NULL)
+		{
+			star = (func[j] * scale) + star;
+		}
+
+		residuum = star - line[j];
+		line[j] = line[j] + (omega * residuum);
+
+		residuum = (residuum < 0) ? -residuum : residuum;
+		maxresiduum = (residuum < maxresiduum) ? maxresiduum : residuum;
+	}
+
+	return maxresiduum;
+}
+
+#ifdef STENCIL_X86
+
+/* ************************************************************************ */
+/* jacobiLineSSE2: two points per instruction                               */
+/* ************************************************************************ */
+__attribute__((target("sse2")))
+static
+double
+jacobiLineSSE2 (double* out, double const* up, double const* mid, double const* down,
+                double const* func, double scale, int n)
+{
+	int j = 1;
+	double lanes[2];
+	double maxresiduum;
+	__m128d const quarter = _mm_set1_pd(0.25);
+	__m128d const sign = _mm_set1_pd(-0.0);
+	__m128d const vscale = _mm_set1_pd(scale);
+	__m128d vmax = _mm_setzero_pd();
+	__m128d star, residuum;
+
+	for (; j + 2 <= n; j += 2)
+	{
+		star = _mm_add_pd(_mm_loadu_pd(up + j), _mm_loadu_pd(mid + j - 1));
+		star = _mm_add_pd(star, _mm_loadu_pd(mid + j + 1));
+		star = _mm_add_pd(star, _mm_loadu_pd(down + j));
+		star = _mm_mul_pd(star, quarter);
+
+		if (func != NULL)
+		{
+			star = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(func + j), vscale), star);
+		}
+
+		residuum = _mm_andnot_pd(sign, _mm_sub_pd(_mm_loadu_pd(mid + j), star));
+		vmax = _mm_max_pd(vmax, residuum);
+
+		_mm_storeu_pd(out + j, star);
+	}
+
+	_mm_storeu_pd(lanes, vmax);
+	maxresiduum = (lanes[0] < lanes[1]) ? lanes[1] : lanes[0];
+
+	if (j < n)
+	{
+		double rest = jacobiLineScalar(out + j - 1, up + j - 1, mid + j - 1, down + j - 1,
+		                               (func != NULL) ? func + j - 1 : NULL, scale, n - j + 1);
+		maxresiduum = (rest < maxresiduum) ? maxresiduum : rest;
+	}
+
+	return maxresiduum;
+}
+
+/* ************************************************************************ */
+/* jacobiLineAVX2: four points per instruction                              */
+/* ************************************************************************ */
+__attribute__((target("avx2")))
+static
+double
+jacobiLineAVX2 (double* out, double const* up, double const* mid, double const* down,
+                double const* func, double scale, int n)
+{
+	int j = 1;
+	double lanes[4];
+	double maxresiduum;
+	__m256d const quarter = _mm256_set1_pd(0.25);
+	__m256d const sign = _mm256_set1_pd(-0.0);
+	__m256d const vscale = _mm256_set1_pd(scale);
+	__m256d vmax = _mm256_setzero_pd();
+	__m256d star, residuum;
+
+	for (; j + 4 <= n; j += 4)
+	{
+		star = _mm256_add_pd(_mm256_loadu_pd(up + j), _mm256_loadu_pd(mid + j - 1));
+		star = _mm256_add_pd(star, _mm256_loadu_pd(mid + j + 1));
+		star = _mm256_add_pd(star, _mm256_loadu_pd(down + j));
+		star = _mm256_mul_pd(star, quarter);
+
+		if (func != NULL)
+		{
+			star = _mm256_add_pd(_mm256_mul_pd(_mm256_loadu_pd(func + j), vscale), star);
+		}
+
+		residuum = _mm256_andnot_pd(sign, _mm256_sub_pd(_mm256_loadu_pd(mid + j), star));
+		vmax = _mm256_max_pd(vmax, residuum);
+
+		_mm256_storeu_pd(out + j, star);
+	}
+
+	_mm256_storeu_pd(lanes, vmax);
+	maxresiduum = (lanes[0] < lanes[1]) ? lanes[1] : lanes[0];
+	maxresiduum = (lanes[2] < maxresiduum) ? maxresiduum : lanes[2];
+	maxresiduum = (lanes[3] < maxresiduum) ? maxresiduum : lanes[3];
+
+	/* the callers are SSE code, avoid the AVX-SSE transition penalty */
+	_mm256_zeroupper();
+
+	if (j < n)
+	{
+		double rest = jacobiLineScalar(out + j - 1, up + j - 1, mid + j - 1, down + j - 1,
+		                               (func != NULL) ? func + j - 1 : NULL, scale, n - j + 1);
+		maxresiduum = (rest < maxresiduum) ? maxresiduum : rest;
+	}
+
+	return maxresiduum;
+}
+
+/* ************************************************************************ */
+/* jacobiLineAVX512: eight points per instruction                           */
+/* ************************************************************************ */
+__attribute__((target("avx512f")))
+static
+double
+jacobiLineAVX512 (double* out, double const* up, double const* mid, double const* down,
+                  double const* func, double scale, int n)
+{
+	int j = 1;
+	double maxresiduum;
+	__m512d const quarter = _mm512_set1_pd(0.25);
+	__m512d const vscale = _mm512_set1_pd(scale);
+	__m512d vmax = _mm512_setzero_pd();
+	__m512d star, residuum;
+
+	for (; j + 8 <= n; j += 8)
+	{
+		star = _mm512_add_pd(_mm512_loadu_pd(up + j), _mm512_loadu_pd(mid + j - 1));
+		star = _mm512_add_pd(star, _mm512_loadu_pd(mid + j + 1));
+		star = _mm512_add_pd(star, _mm512_loadu_pd(down + j));
+		star = _mm512_mul_pd(star, quarter);
+
+		if (func != NULL)
+		{
+			star = _mm512_add_pd(_mm512_mul_pd(_mm512_loadu_pd(func + j), vscale), star);
+		}
+
+		residuum = _mm512_abs_pd(_mm512_sub_pd(_mm512_loadu_pd(mid + j), star));
+		vmax = _mm512_max_pd(vmax, residuum);
+
+		_mm512_storeu_pd(out + j, star);
+	}
+
+	maxresiduum = _mm512_reduce_max_pd(vmax);
+
+	/* the callers are SSE code, avoid the AVX-SSE transition penalty */
+	_mm256_zeroupper();
+
+	if (j < n)
+	{
+		double rest = jacobiLineScalar(out + j - 1, up + j - 1, mid + j - 1, down + j - 1,
+		                               (func != NULL) ? func + j - 1 : NULL, scale, n - j + 1);
+		maxresiduum = (rest < maxresiduum) ? maxresiduum : rest;
+	}
+
+	return maxresiduum;
+}
+
+/* ************************************************************************ */
+/* jacobiLineFloatSSE2: four points per instruction                         */
+/* ************************************************************************ */
+__attribute__((target("sse2")))
+static
+float
+jacobiLineFloatSSE2 (float* out, float const* up, float const* mid, float const* down,
+                     float const* func, float scale, int n)
+{
+	int j = 1;
+	int k;
+	float lanes[4];
+	float maxresiduum;
+	__m128 const quarter = _mm_set1_ps(0.25f);
+	__m128 const sign = _mm_set1_ps(-0.0f);
+	__m128 const vscale = _mm_set1_ps(scale);
+	__m128 vmax = _mm_setzero_ps();
+	__m128 star, residuum;
+
+	for (; j + 4 <= n; j += 4)
+	{
+		star = _mm_add_ps(_mm_loadu_ps(up + j), _mm_loadu_ps(mid + j - 1));
+		star = _mm_add_ps(star, _mm_loadu_ps(mid + j + 1));
+		star = _mm_add_ps(star, _mm_loadu_ps(down + j));
+		star = _mm_mul_ps(star, quarter);
+
+		if (func != NULL)
+		{
+			star = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(func + j), vscale), star);
+		}
+
+		residuum = _mm_andnot_ps(sign, _mm_sub_ps(_mm_loadu_ps(mid + j), star));
+		vmax = _mm_max_ps(vmax, residuum);
+
+		_mm_storeu_ps(out + j, star);
+	}
+
+	_mm_storeu_ps(lanes, vmax);
+	maxresiduum = lanes[0];
+	for (k = 1; k < 4; k++)
+	{
+		maxresiduum = (lanes[k] < maxresiduum) ? maxresiduum : lanes[k];
+	}
+
+	if (j < n)
+	{
+		float rest = jacobiLineFloatScalar(out + j - 1, up + j - 1, mid + j - 1, down + j - 1,
+		                                   (func != NULL) ? func + j - 1 : NULL, scale, n - j + 1);
+		maxresiduum = (rest < maxresiduum) ? maxresiduum : rest;
+	}
+
+	return maxresiduum;
+}
+
+/* ************************************************************************ */
+/* jacobiLineFloatAVX2: eight points per instruction                        */
+/* ************************************************************************ */
+__attribute__((target("avx2")))
+static
+float
+jacobiLineFloatAVX2 (float* out, float const* up, float const* mid, float const* down,
+                     float const* func, float scale, int n)
+{
+	int j = 1;
+	int k;
+	float lanes[8];
+	float maxresiduum;
+	__m256 const quarter = _mm256_set1_ps(0.25f);
+	__m256 const sign = _mm256_set1_ps(-0.0f);
+	__m256 const vscale = _mm256_set1_ps(scale);
+	__m256 vmax = _mm256_setzero_ps();
+	__m256 star, residuum;
+
+	for (; j + 8 <= n; j += 8)
+	{
+		star = _mm256_add_ps(_mm256_loadu_ps(up + j), _mm256_loadu_ps(mid + j - 1));
+		star = _mm256_add_ps(star, _mm256_loadu_ps(mid + j + 1));
+		star = _mm256_add_ps(star, _mm256_loadu_ps(down + j));
+		star = _mm256_mul_ps(star, quarter);
+
+		if (func != NULL)
+		{
+			star = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(func + j), vscale), star);
+		}
+
+		residuum = _mm256_andnot_ps(sign, _mm256_sub_ps(_mm256_loadu_ps(mid + j), star));
+		vmax = _mm256_max_ps(vmax, residuum);
+
+		_mm256_storeu_ps(out + j, star);
+	}
+
+	_mm256_storeu_ps(lanes, vmax);
+	maxresiduum = lanes[0];
+	for (k = 1; k < 8; k++)
+	{
+		maxresiduum = (lanes[k] < maxresiduum) ? maxresiduum : lanes[k];
+	}
+
+	/* the callers are SSE code, avoid the AVX-SSE transition penalty */
+	_mm256_zeroupper();
+
+	if (j < n)
+	{
+		float rest = jacobiLineFloatScalar(out + j - 1, up + j - 1, mid + j - 1, down + j - 1,
+		                                   (func != NULL) ? func + j - 1 : NULL, scale, n - j + 1);
+		maxresiduum = (rest < maxresiduum) ? maxresiduum : rest;
+	}
+
+	return maxresiduum;
+}
+
+/* ************************************************************************ */
+/* jacobiLineFloatAVX512: sixteen points per instruction                    */
+/* ************************************************************************ */
+__attribute__((target("avx512f")))
+static
+float
+jacobiLineFloatAVX512 (float* out, float const* up, float const* mid, float const* down,
+                       float const* func, float scale, int n)
+{
+	int j = 1;
+	float maxresiduum;
+	__m512 const quarter = _mm512_set1_ps(0.25f);
+	__m512 const vscale = _mm512_set1_ps(scale);
+	__m512 vmax = _mm512_setzero_ps();
+	__m512 star, residuum;
+
+	for (; j + 16 <= n; j += 16)
+	{
+		star = _mm512_add_ps(_mm512_loadu_ps(up + j), _mm512_loadu_ps(mid + j - 1));
+		star = _mm512_add_ps(star, _mm512_loadu_ps(mid + j + 1));
+		star = _mm512_add_ps(star, _mm512_loadu_ps(down + j));
+		star = _mm512_mul_ps(star, quarter);
+
+		if (func != NULL)
+		{
+			star = _mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(func + j), vscale), star);
+		}
+
+		residuum = _mm512_abs_ps(_mm512_sub_ps(_mm512_loadu_ps(mid + j), star));
+		vmax = _mm512_max_ps(vmax, residuum);
+
+		_mm512_storeu_ps(out + j, star);
+	}
+
+	maxresiduum = _mm512_reduce_max_ps(vmax);
+
+	/* the callers are SSE code, avoid the AVX-SSE transition penalty */
+	_mm256_zeroupper();
+
+	if (j < n)
+	{
+		float rest = jacobiLineFloatScalar(out + j - 1, up + j - 1, mid + j - 1, down + j - 1,
+		                                   (func != NULL) ? func + j - 1 : NULL, scale, n - j + 1);
+		maxresiduum = (rest < maxresiduum) ? maxresiduum : rest;
+	}
+
+	return maxresiduum;
+}
+
+#endif
+
+/* ************************************************************************ */
+/* initStencil: selects the Jacobi line kernels (double and float) from    */
+/* CPUID or from the environment variable PARTDIFF_KERNEL                   */
+/* ************************************************************************ */
+void
+initStencil (void)
+{
+	const char* wanted = getenv("PARTDIFF_KERNEL");
+
+	jacobiLine = jacobiLineScalar;
+	jacobiLineFloat = jacobiLineFloatScalar;
+	kernel_name = "scalar";
+
+	if (wanted != NULL && strcmp(wanted, "scalar") == 0)
+	{
+		return;
+	}
+
+#ifdef STENCIL_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx512f") && (wanted == NULL || strcmp(wanted, "avx512") == 0))
+	{
+		jacobiLine = jacobiLineAVX512;
+		jacobiLineFloat = jacobiLineFloatAVX512;
+		kernel_name = "avx512";
+	}
+	else if (__builtin_cpu_supports("avx2") && (wanted == NULL || strcmp(wanted, "avx2") == 0))
+	{
+		jacobiLine = jacobiLineAVX2;
+		jacobiLineFloat = jacobiLineFloatAVX2;
+		kernel_name = "avx2";
+	}
+	else if (__builtin_cpu_supports("sse2") && (wanted == NULL || strcmp(wanted, "sse2") == 0))
+	{
+		jacobiLine = jacobiLineSSE2;
+		jacobiLineFloat = jacobiLineFloatSSE2;
+		kernel_name = "sse2";
+	}
+#endif
+
+	if (wanted != NULL && strcmp(wanted, kernel_name) != 0)
+	{
+		printf("Kernel %s nicht verfuegbar, verwende %s.\n", wanted, kernel_name);
+	}
+}
+
+/* ************************************************************************ */
+/* stencilName: name of the selected kernel                                 */
+/* ************************************************************************ */
+const char*
+stencilName (void)
+{
+	return kernel_name;
+}
@@ -0,0 +1,57 @@
+/****************************************************************************/
+/****************************************************************************/
+/**                                                                        **/
+/**                TU Muenchen - Institut fuer Informatik                  **/
+/**                                                                        **/
+/** Copyright: Prof. Dr. Thomas Ludwig                                     **/
+/**            Andreas C. Schmidt                                          **/
+/**                                                                        **/
+/** File:      stencil.h                                                   **/
+/**                                                                        **/
+/** Purpose:   Vectorized Jacobi line kernels (double and float), selected **/
+/**            at startup, and the in-place Gauss-Seidel and SOR line      **/
+/**            kernels.                                                    **/
+/**                                                                        **/
+/****************************************************************************/
+/****************************************************************************/
+
+#ifndef STENCIL_H
+#define STENCIL_H
+
+/* ************************************************************************ */
+/* A Jacobi line kernel calculates out[j] for 0 < j < n from the lines      */
+/* up, mid and down of the old matrix:                                      */
+/*                                                                          */
+/*   star = (up[j] + mid[j-1] + mid[j+1] + down[j]) * 0.25                  */
+/*   star = (func[j] * scale) + star              (only if func != NULL)    */
+/*                                                                          */
+/* and returns the maximum of |mid[j] - star| over the line. All kernels    */
+/* perform the same operations in the same order, so every kernel gives     */
+/* bit-identical results.                                                   */
+/* ************************************************************************ */
+typedef double (*jacobi_line_t) ( double*, double const*, double const*, double const*,
+                                  double const*, double, int );
+
+/* kernel selected by initStencil() */
+extern jacobi_line_t jacobiLine;
+
+/* The same in float, twice the points per instruction (mixed precision)    */
+typedef float (*jacobi_line_float_t) ( float*, float const*, float const*, float const*,
+                                       float const*, float, int );
+
+extern jacobi_line_float_t jacobiLineFloat;
+
+/* *************************** */
+/* Some function declarations. */
+/* *************************** */
+/* Documentation in stencil.c  */
+/* *************************** */
+void initStencil ( void );
+
+double gaussSeidelLine ( double*, double const*, double const*, double const*, double, int, int, int );
+
+double sorLine ( double*, double const*, double const*, double const*, double, double, int, int, int );
+
+const char* stencilName ( void );
+
+#endif
@@ -0,0 +1,188 @@
+/****************************************************************************/
+/****************************************************************************/
+/**                                                                        **/
+/**                TU Muenchen - Institut fuer Informatik                  **/
+/**                                                                        **/
+/** Copyright: Prof. Dr. Thomas Ludwig                                     **/
+/**            Andreas C. Schmidt                                          **/
+/**                                                                        **/
+/** File:      clocksync.c                                                 **/
+/**                                                                        **/
+/** Purpose:   Clock synchronization after Cristian: a process sends its   **/
+/**            time t0 to rank 0, rank 0 answers with its time tm, the    **/
+/**            process reads t1 on arrival. tm was read somewhere between  **/
+/**            t0 and t1, so offset = (t0 + t1) / 2 - tm is off by at most **/
+/**            (t1 - t0) / 2. Of CLOCKSYNC_ROUNDS ping-pongs the fastest   **/
+/**            counts. Two measurements (before and after a run) give the  **/
+/**            drift. The clock is CLOCK_MONOTONIC, unlike gettimeofday()  **/
+/**            it is not set back by NTP while the program runs; the      **/
+/**            offset absorbs its arbitrary origin.                        **/
+/**                                                                        **/
+/****************************************************************************/
+/****************************************************************************/
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "clocksync.h"
+
+#define CLOCKSYNC_TAG	4711
+
+/* ************************************************************************ */
+/* clockNow: seconds of CLOCK_MONOTONIC                                     */
+/* ************************************************************************ */
+double
+clockNow (void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* ************************************************************************ */
+/* clockSync: one measurement of all processes against rank 0 (collective   */
+/* over comm). The first call sets offset and error, every later one the    */
+/* drift since the first.                                                   */
+/* ************************************************************************ */
+void
+clockSync (struct clocksync* c, MPI_Comm comm)
+{
+	int r, k;
+	int rank, size;
+	double t0, t1, tm;
+	double trip = -1;                           /* shortest round trip         */
+	double offset = 0;                          /* and its measurement         */
+	double middle = 0;
+
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &size);
+
+	/* rank 0 serves one process after the other, nobody else disturbs it */
+	for (r = 1; r < size; r++)
+	{
+		if (0 == rank)
+		{
+			for (k = 0; k < CLOCKSYNC_ROUNDS; k++)
+			{
+				MPI_Recv(&t0, 1, MPI_DOUBLE, r, CLOCKSYNC_TAG, comm, MPI_STATUS_IGNORE);
+				tm = clockNow();
+				MPI_Send(&tm, 1, MPI_DOUBLE, r, CLOCKSYNC_TAG, comm);
+			}
+		}
+		else if (r == rank)
+		{
+			for (k = 0; k < CLOCKSYNC_ROUNDS; k++)
+			{
+				t0 = clockNow();
+				MPI_Send(&t0, 1, MPI_DOUBLE, 0, CLOCKSYNC_TAG, comm);
+				MPI_Recv(&tm, 1, MPI_DOUBLE, 0, CLOCKSYNC_TAG, comm, MPI_STATUS_IGNORE);
+				t1 = clockNow();
+
+				if (trip < 0 || t1 - t0 < trip)
+				{
+					trip = t1 - t0;
+					middle = (t0 + t1) / 2;
+					offset = middle - tm;
+				}
+			}
+		}
+	}
+
+	if (0 == rank)
+	{
+		/* the reference clock */
+		trip = 0;
+		middle = clockNow();
+	}
+
+	if (0 == c->samples)
+	{
+		c->reference = middle;
+		c->offset = offset;
+		c->drift = 0;
+		c->error = trip / 2;
+		c->drift_error = 0;
+	}
+	else if (middle > c->reference)
+	{
+		c->drift = (offset - c->offset) / (middle - c->reference);
+		c->drift_error = (c->error + trip / 2) / (middle - c->reference);
+	}
+
+	c->last = middle;
+	c->samples++;
+}
+
+/* ************************************************************************ */
+/* clockGlobal: local seconds (clockNow) on the timeline of rank 0          */
+/* ************************************************************************ */
+double
+clockGlobal (struct clocksync const* c, double local)
+{
+	return local - c->offset - c->drift * (local - c->reference);
+}
+
+/* ************************************************************************ */
+/* clockUncertainty: bound of the error of clockGlobal(c, local) in seconds */
+/* ************************************************************************ */
+double
+clockUncertainty (struct clocksync const* c, double local)
+{
+	return c->error + c->drift_error * fabs(local - c->reference);
+}
+
+/* ************************************************************************ */
+/* clockReport: rank 0 prints offset, drift and uncertainty of every        */
+/* process (collective over comm)                                           */
+/* ************************************************************************ */
+void
+clockReport (struct clocksync const* c, MPI_Comm comm)
+{
+	int r;
+	int rank, size;
+	double mine[3];
+	double* all = NULL;
+	double worst = 0;
+
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &size);
+
+	mine[0] = c->offset;
+	mine[1] = c->drift;
+	mine[2] = clockUncertainty(c, c->last);
+
+	if (0 == rank)
+	{
+		all = malloc(3 * size * sizeof(double));
+
+		if (NULL == all)
+		{
+			printf("Speicherprobleme! (Uhren)\n");
+			MPI_Abort(comm, 1);
+		}
+	}
+
+	MPI_Gather(mine, 3, MPI_DOUBLE, all, 3, MPI_DOUBLE, 0, comm);
+
+	if (0 != rank)
+	{
+		return;
+	}
+
+	for (r = 1; r < size; r++)
+	{
+		printf("Uhr Prozess %3d:    Versatz %+.6f s, Drift %+.3f ppm, Unsicherheit %.1f us\n",
+		       r, all[3 * r], all[3 * r + 1] * 1e6, all[3 * r + 2] * 1e6);
+		worst = (all[3 * r + 2] < worst) ? worst : all[3 * r + 2];
+	}
+
+	printf("Uhren:              %d Prozesse auf der Zeitachse von Rang 0, Unsicherheit bis %.1f us\n",
+	       size, worst * 1e6);
+
+	free(all);
+}
@@ -0,0 +1,58 @@
+/****************************************************************************/
+/****************************************************************************/
+/**                                                                        **/
+/**                TU Muenchen - Institut fuer Informatik                  **/
+/**                                                                        **/
+/** Copyright: Prof. Dr. Thomas Ludwig                                     **/
+/**            Andreas C. Schmidt                                          **/
+/**                                                                        **/
+/** File:      clocksync.h                                                 **/
+/**                                                                        **/
+/** Purpose:   Offset and drift of the clock of every MPI process against  **/
+/**            the clock of rank 0, estimated with ping-pong rounds, and   **/
+/**            the conversion of local times onto the timeline of rank 0.  **/
+/**                                                                        **/
+/****************************************************************************/
+/****************************************************************************/
+
+#ifndef CLOCKSYNC_H
+#define CLOCKSYNC_H
+
+#include <mpi.h>
+
+/* ************* */
+/* Some defines. */
+/* ************* */
+#define CLOCKSYNC_ROUNDS	32	/* ping-pongs per measurement, the fastest counts */
+
+/* ************************************************************************ */
+/* The clock of one process relative to rank 0:                             */
+/*   rank 0 time = local time - offset - drift * (local time - reference)   */
+/* ************************************************************************ */
+struct clocksync
+{
+	double  reference;      /* local seconds of the first measurement         */
+	double  offset;         /* local minus rank 0 at reference                */
+	double  drift;          /* seconds per second, 0 after one measurement    */
+	double  error;          /* of offset: half the shortest round trip        */
+	double  drift_error;    /* of drift: both errors over the time between    */
+	double  last;           /* local seconds of the last measurement          */
+	int     samples;        /* measurements so far                            */
+};
+
+/* **************************** */
+/* Some function declarations.  */
+/* **************************** */
+/* Documentation in clocksync.c */
+/* **************************** */
+double clockNow ( void );
+
+void clockSync ( struct clocksync*, MPI_Comm );
+
+double clockGlobal ( struct clocksync const*, double );
+
+double clockUncertainty ( struct clocksync const*, double );
+
+void clockReport ( struct clocksync const*, MPI_Comm );
+
+#endif
@@ -0,0 +1,76 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <mpi.h>
+#include <stdio.h>
+#include <time.h>
+#include "clocksync.h"
+
+/* like timempi2, but the timestamps of all ranks are corrected onto the
+   clock of rank 0 (clocksync.c) instead of comparing raw gettimeofday() */
+int main(int argc,char* argv[])
+{
+  int numtasks, rank, rc;
+  const int buf_size = MPI_MAX_PROCESSOR_NAME + 64;	/* Size of the buffer for timestamp */
+  struct clocksync clocks = { 0, 0, 0, 0, 0, 0, 0 };
+  struct timespec pause = { 1, 0 };	/* between the two measurements (drift) */
+  double local, global, first;
+  /* initialize MPI and check for success*/
+  rc = MPI_Init(&argc,&argv);
+  if (rc != MPI_SUCCESS)
+    {
+      printf ("Error starting MPI programm. Termianting.\n");
+      MPI_Abort(MPI_COMM_WORLD, rc);
+    }
+  /* get size of comm and rank in that comm */
+  MPI_Comm_size(MPI_COMM_WORLD,&numtasks );
+  MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+  /* Make sure we have at least 2 processes(need at least that much). */
+  if (numtasks < 2)
+    {
+      fprintf(stderr, "World size must be at least two for %s to run properly!\n", argv[0]);
+      MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+  /* get hostname */
+  char hostname[MPI_MAX_PROCESSOR_NAME];
+  int resultlength=0;
+  MPI_Get_processor_name(hostname,&resultlength);
+  /* offset, then drift over the pause */
+  clockSync(&clocks, MPI_COMM_WORLD);
+  nanosleep(&pause, NULL);
+  clockSync(&clocks, MPI_COMM_WORLD);
+  /* get current time, right after a barrier */
+  MPI_Barrier(MPI_COMM_WORLD);
+  local = clockNow();
+  global = clockGlobal(&clocks, local);
+  first = global;
+  MPI_Bcast(&first, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+  /* workernodes do */
+  if (rank != 0)
+    {
+      /* make formatted string from time */
+      char timestamp[buf_size];
+      snprintf(timestamp,buf_size,"%s(%d): %+.1fus after rank 0 (+-%.1fus)\n",
+	       hostname,
+	       rank,
+	       (global - first) * 1e6,
+	       clockUncertainty(&clocks, local) * 1e6);
+      /* send timestamp to Master */
+      MPI_Send(timestamp, buf_size, MPI_CHAR, 0, 0, MPI_COMM_WORLD);
+    }else if (rank == 0)
+    {
+      /* print recieved messages */
+      printf("The masternode recieved the following timestamps:\n");
+      char buf[buf_size];
+      for (int i = 1; i < numtasks; i++)
+	{
+	  MPI_Recv(buf, buf_size, MPI_CHAR, i, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+	  fprintf(stdout, "%s", buf);
+	}
+    }
+  clockReport(&clocks, MPI_COMM_WORLD);
+  MPI_Barrier(MPI_COMM_WORLD);
+  fprintf(stdout,"Rang %d beendet jetzt!\n",rank);
+  /* finalize the MPI environment */
+  MPI_Finalize();
+  return 0;
+}
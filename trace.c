@@ -0,0 +1,282 @@
+/****************************************************************************/
+/****************************************************************************/
+/**                                                                        **/
+/**                TU Muenchen - Institut fuer Informatik                  **/
+/**                                                                        **/
+/** Copyright: Prof. Dr. Thomas Ludwig                                     **/
+/**            Andreas C. Schmidt                                          **/
+/**                                                                        **/
+/** File:      trace.c                                                     **/
+/**                                                                        **/
+/** Purpose:   Event tracing. Every thread keeps a stack of open phases    **/
+/**            and a preallocated ring buffer of complete events (name,    **/
+/**            begin, duration); nothing is allocated or written while     **/
+/**            the solver runs. At the end the events are formatted as     **/
+/**            Chrome trace events ("ph":"X", pid = process, tid =        **/
+/**            thread, microseconds of CLOCK_MONOTONIC, so the processes   **/
+/**            of one node share the time axis; traceClock() moves them    **/
+/**            onto the clock of another node) and written to the file     **/
+/**            named by PARTDIFF_TRACE. It opens in chrome://tracing and   **/
+/**            ui.perfetto.dev.                                            **/
+/**                                                                        **/
+/****************************************************************************/
+/****************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "trace.h"
+#include "grid.h"
+
+/* ************************************************************************ */
+/* One complete event and the buffers of one thread                         */
+/* ************************************************************************ */
+struct trace_event
+{
+	char const* name;
+	double  begin;          /* microseconds                                   */
+	double  duration;
+};
+
+struct trace_thread
+{
+	struct trace_event* ring; /* TRACE_EVENTS events                          */
+	long    count;          /* events so far, the next goes to count % size   */
+	int     depth;          /* open phases                                    */
+	char const* name[TRACE_DEPTH];
+	double  begin[TRACE_DEPTH];
+	char    pad[GRID_ALIGNMENT]; /* no two threads in one cache line         */
+};
+
+int trace_on = 0;
+
+static struct trace_thread* trace = NULL;
+static int trace_threads = 0;
+static int trace_process = 0;
+static double trace_offset = 0;             /* traceClock(), microseconds  */
+static double trace_drift = 0;
+static double trace_reference = 0;
+static double trace_uncertainty = 0;
+
+/* ************************************************************************ */
+/* now: microseconds of CLOCK_MONOTONIC                                     */
+/* ************************************************************************ */
+static
+double
+now (void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	return t.tv_sec * 1e6 + t.tv_nsec * 1e-3;
+}
+
+/* ************************************************************************ */
+/* traceWanted: 1 if PARTDIFF_TRACE names a file                            */
+/* ************************************************************************ */
+int
+traceWanted (void)
+{
+	char const* file = getenv("PARTDIFF_TRACE");
+
+	return (NULL != file && '\0' != file[0]);
+}
+
+/* ************************************************************************ */
+/* traceInit: buffers for threads threads, process: pid in the trace (MPI   */
+/* rank); switches tracing on                                               */
+/* ************************************************************************ */
+void
+traceInit (int threads, int process)
+{
+	int t;
+
+	trace = malloc(threads * sizeof(struct trace_thread));
+
+	if (NULL == trace)
+	{
+		printf("Speicherprobleme! (Trace)\n");
+		exit(1);
+	}
+
+	for (t = 0; t < threads; t++)
+	{
+		trace[t].ring = malloc(TRACE_EVENTS * sizeof(struct trace_event));
+		trace[t].count = 0;
+		trace[t].depth = 0;
+
+		if (NULL == trace[t].ring)
+		{
+			printf("Speicherprobleme! (Trace)\n");
+			exit(1);
+		}
+	}
+
+	trace_threads = threads;
+	trace_process = process;
+	trace_on = 1;
+}
+
+/* ************************************************************************ */
+/* traceClock: the events are written on another timeline,                  */
+/* t - offset - drift * (t - reference), with uncertainty (all seconds of   */
+/* CLOCK_MONOTONIC, see clocksync.h)                                        */
+/* ************************************************************************ */
+void
+traceClock (double offset, double drift, double reference, double uncertainty)
+{
+	trace_offset = offset * 1e6;
+	trace_drift = drift;
+	trace_reference = reference * 1e6;
+	trace_uncertainty = uncertainty * 1e6;
+}
+
+/* ************************************************************************ */
+/* traceBegin: thread t enters phase name                                   */
+/* ************************************************************************ */
+void
+traceBegin (int t, char const* name)
+{
+	struct trace_thread* me = &trace[t];
+
+	/* deeper phases are not recorded */
+	if (me->depth < TRACE_DEPTH)
+	{
+		me->name[me->depth] = name;
+		me->begin[me->depth] = now();
+	}
+
+	me->depth++;
+}
+
+/* ************************************************************************ */
+/* traceEnd: thread t leaves its innermost phase                            */
+/* ************************************************************************ */
+void
+traceEnd (int t)
+{
+	struct trace_thread* me = &trace[t];
+	struct trace_event* e;
+
+	me->depth--;
+
+	if (me->depth < TRACE_DEPTH)
+	{
+		e = &me->ring[me->count % TRACE_EVENTS];
+		e->name = me->name[me->depth];
+		e->begin = me->begin[me->depth];
+		e->duration = now() - e->begin;
+		me->count++;
+	}
+}
+
+/* ************************************************************************ */
+/* traceEvents: the events of this process as JSON objects, each followed   */
+/* by ",\n", so the texts of several processes can be concatenated;         */
+/* returns a malloc'ed text of *length bytes                                */
+/* ************************************************************************ */
+char*
+traceEvents (size_t* length)
+{
+	int t;
+	long k, first;
+	char* text = NULL;
+	FILE* out = open_memstream(&text, length);
+
+	if (NULL == out)
+	{
+		printf("Speicherprobleme! (Trace)\n");
+		exit(1);
+	}
+
+	fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"Prozess %d\",\"uncertainty_us\":%.3f}},\n",
+	        trace_process, trace_process, trace_uncertainty);
+
+	for (t = 0; t < trace_threads; t++)
+	{
+		/* the oldest events are lost if the ring ran over */
+		first = (trace[t].count > TRACE_EVENTS) ? trace[t].count - TRACE_EVENTS : 0;
+
+		fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"Thread %d\",\"dropped\":%ld}},\n",
+		        trace_process, t, t, first);
+
+		for (k = first; k < trace[t].count; k++)
+		{
+			struct trace_event const* e = &trace[t].ring[k % TRACE_EVENTS];
+
+			fprintf(out, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f},\n",
+			        e->name, trace_process, t,
+			        e->begin - trace_offset - trace_drift * (e->begin - trace_reference),
+			        e->duration * (1 - trace_drift));
+		}
+	}
+
+	fclose(out);
+
+	return text;
+}
+
+/* ************************************************************************ */
+/* traceSave: writes the events (of all processes, see traceEvents) as      */
+/* Chrome trace to the file PARTDIFF_TRACE                                  */
+/* ************************************************************************ */
+void
+traceSave (char const* events, size_t length)
+{
+	char const* file = getenv("PARTDIFF_TRACE");
+	FILE* out = fopen(file, "w");
+
+	if (NULL == out)
+	{
+		printf("Trace %s kann nicht geschrieben werden.\n", file);
+		return;
+	}
+
+	/* without the comma after the last event */
+	fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fwrite(events, 1, (length >= 2) ? length - 2 : 0, out);
+	fprintf(out, "\n]}\n");
+	fclose(out);
+}
+
+/* ************************************************************************ */
+/* traceFree: switches tracing off and frees the buffers                    */
+/* ************************************************************************ */
+void
+traceFree (void)
+{
+	int t;
+
+	for (t = 0; t < trace_threads; t++)
+	{
+		free(trace[t].ring);
+	}
+
+	free(trace);
+	trace = NULL;
+	trace_threads = 0;
+	trace_on = 0;
+}
+
+/* ************************************************************************ */
+/* traceFinish: one process: writes its events and frees the buffers        */
+/* ************************************************************************ */
+void
+traceFinish (void)
+{
+	size_t length;
+	char* events;
+
+	if (!trace_on)
+	{
+		return;
+	}
+
+	events = traceEvents(&length);
+	traceSave(events, length);
+	free(events);
+	traceFree();
+}
@@ -0,0 +1,63 @@
+/****************************************************************************/
+/****************************************************************************/
+/**                                                                        **/
+/**                TU Muenchen - Institut fuer Informatik                  **/
+/**                                                                        **/
+/** Copyright: Prof. Dr. Thomas Ludwig                                     **/
+/**            Andreas C. Schmidt                                          **/
+/**                                                                        **/
+/** File:      trace.h                                                     **/
+/**                                                                        **/
+/** Purpose:   Event tracing per thread and process into ring buffers,     **/
+/**            written as Chrome trace / Perfetto JSON. Switched on with   **/
+/**            the environment variable PARTDIFF_TRACE=<file>.             **/
+/**                                                                        **/
+/****************************************************************************/
+/****************************************************************************/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+
+/* ************* */
+/* Some defines. */
+/* ************* */
+#define TRACE_EVENTS		(1 << 16)	/* per thread, then the oldest are overwritten */
+#define TRACE_DEPTH		8		/* nested begin/end per thread                 */
+
+/* 1 after traceInit() */
+extern int trace_on;
+
+/* ************************************************************************ */
+/* Begin and end of a phase of thread t (0 .. threads-1 of traceInit()).    */
+/* The name must be a string constant; the phases of a thread must nest.    */
+/* Without tracing a phase costs one test of trace_on.                      */
+/* ************************************************************************ */
+#define TRACE_BEGIN(t, name)	do { if (trace_on) traceBegin((t), (name)); } while (0)
+#define TRACE_END(t)		do { if (trace_on) traceEnd(t); } while (0)
+
+/* *************************** */
+/* Some function declarations. */
+/* *************************** */
+/* Documentation in trace.c    */
+/* *************************** */
+int traceWanted ( void );
+
+void traceInit ( int, int );
+
+void traceClock ( double, double, double, double );
+
+void traceBegin ( int, char const* );
+
+void traceEnd ( int );
+
+char* traceEvents ( size_t* );
+
+void traceSave ( char const*, size_t );
+
+void traceFree ( void );
+
+void traceFinish ( void );
+
+#endif